@@ -0,0 +1,110 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Totem.hpp"
+#include "FrameSinks.hpp"
+#include "SimAudio.hpp"
+
+#include "patterns/AudioSpectrumPattern.hpp"
+#include "patterns/LoadingPattern.hpp"
+#include "patterns/SinglePixelPattern.hpp"
+#include "patterns/SolidColorPattern.hpp"
+#include "playlists/DefaultPlaylist.hpp"
+#include "patterns/WifiConnectingPattern.hpp"
+
+static constexpr auto TAG = "TotemSim";
+
+// The firmware never shuts down, so neither Totem nor the patterns have an orderly teardown. Sinks flush every
+// frame, leave without running static destructors under the live threads.
+[[noreturn]] static void quit(const int status)
+{
+    std::fflush(nullptr);
+    std::_Exit(status);
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --pattern NAME   pattern to run (default DefaultPlaylist)\n"
+                 "  --frames N       stop after N displayed frames (default 300)\n"
+                 "  --wav FILE       feed the microphone from a PCM WAV file, looped\n"
+                 "  --ppm DIR        write every frame as DIR/frame_NNNNN.ppm\n"
+                 "  --raw FILE       append every frame to FILE as raw 0x00RRGGBB words\n"
+                 "  --list           print the registered patterns and exit\n",
+                 argv0);
+}
+
+int main(const int argc, char** argv)
+{
+    std::string pattern_name = "DefaultPlaylist";
+    uint32_t frames = 300;
+    bool list = false;
+
+    // Same set as app_main
+    PatternRegistry::add_pattern<AudioSpectrumPattern>();
+    PatternRegistry::add_pattern<FirePattern>();
+    PatternRegistry::add_pattern<WifiConnectingPattern>();
+    PatternRegistry::add_pattern<DefaultPlaylist>();
+    PatternRegistry::add_pattern<LoadingPattern>();
+    PatternRegistry::add_pattern<SolidColorPattern>();
+    PatternRegistry::add_pattern<SinglePixelPattern>();
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--pattern" && has_value) pattern_name = argv[++i];
+        else if (arg == "--frames" && has_value) frames = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--wav" && has_value) ESP_ERROR_CHECK(SimAudio::loadWav(argv[++i]));
+        else if (arg == "--ppm" && has_value) MatrixDriver::setFrameSink(sim::ppmSink(argv[++i]));
+        else if (arg == "--raw" && has_value) MatrixDriver::setFrameSink(sim::rawSink(argv[++i]));
+        else if (arg == "--list") list = true;
+        else
+        {
+            usage(argv[0]);
+            quit(EXIT_FAILURE);
+        }
+    }
+
+    if (list)
+    {
+        for (const auto& name : PatternRegistry::get_pattern_names())
+        {
+            std::printf("%s\n", name.c_str());
+        }
+        quit(EXIT_SUCCESS);
+    }
+
+    ESP_ERROR_CHECK(MatrixDriver::start());
+    ESP_ERROR_CHECK(Microphone::start());
+    ESP_ERROR_CHECK(Totem::start());
+
+    if (Totem::set_pattern(pattern_name) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unknown pattern %s", pattern_name.c_str());
+        quit(EXIT_FAILURE);
+    }
+
+    const int64_t start_us = esp_timer_get_time();
+    while (MatrixDriver::getFrameCount() < frames)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    const int64_t elapsed_us = esp_timer_get_time() - start_us;
+
+    const auto timing = Totem::get_stage_timing();
+    ESP_LOGI(TAG, "%u frames in %" PRId64 " ms, render %u us, encode %u us, missed frames %u, missed renders %u",
+             MatrixDriver::getFrameCount(), elapsed_us / 1000, timing.render_us, timing.encode_us,
+             Totem::get_missed_frames(), Totem::get_missed_renders());
+    ESP_LOGI(TAG, "Audio to photon %u us, %u microphone hops dropped", timing.audio_latency_us,
+             Microphone::getOverruns());
+    const auto pool = FramePool::getOccupancy();
+    ESP_LOGI(TAG, "Frame pool: %u of %u buffers at peak, %u leases refused", pool.peak, pool.capacity,
+             pool.exhausted);
+
+    quit(EXIT_SUCCESS);
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+/**
+ * @brief Minimal harness shared by the host benchmarks
+ *
+ * Times a callable per iteration and counts the heap allocations it makes on the calling thread. Results are
+ * collected as one JSON object per case so runs can be diffed between firmware versions.
+ *
+ * Include from exactly one translation unit per executable, it replaces the global allocation functions.
+ */
+namespace bench
+{
+    struct AllocCounter
+    {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Per thread so that allocations of the microphone and other background threads are not charged to the case
+    inline thread_local AllocCounter allocs;
+
+    struct Result
+    {
+        std::string name;
+        uint32_t iterations = 0;
+        double ns_mean = 0;
+        uint64_t ns_p50 = 0;
+        uint64_t ns_p99 = 0;
+        uint64_t ns_max = 0;
+        double allocs_per_iter = 0;
+        double alloc_bytes_per_iter = 0;
+        nlohmann::json extra = nlohmann::json::object();
+
+        [[nodiscard]] nlohmann::json toJson() const
+        {
+            nlohmann::json j = {
+                {"name", name},
+                {"iterations", iterations},
+                {"ns_mean", ns_mean},
+                {"ns_p50", ns_p50},
+                {"ns_p99", ns_p99},
+                {"ns_max", ns_max},
+                {"allocs_per_iter", allocs_per_iter},
+                {"alloc_bytes_per_iter", alloc_bytes_per_iter},
+            };
+            j.update(extra);
+            return j;
+        }
+    };
+
+    // Run fn warmup times untimed, then iterations times timed one by one. after(i) runs outside the timed region
+    // and may add to the result, e.g. inspect what the iteration produced.
+    template <typename Fn, typename After>
+    Result run(std::string name, const uint32_t iterations, const uint32_t warmup, Fn&& fn, After&& after)
+    {
+        using clock = std::chrono::steady_clock;
+
+        for (uint32_t i = 0; i < warmup; i++)
+        {
+            fn();
+        }
+
+        std::vector<uint64_t> samples(iterations);
+        AllocCounter measured;
+
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            const AllocCounter before = allocs;
+            const auto start = clock::now();
+            fn();
+            const auto end = clock::now();
+            measured.count += allocs.count - before.count;
+            measured.bytes += allocs.bytes - before.bytes;
+
+            samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            after(i);
+        }
+
+        Result result{.name = std::move(name), .iterations = iterations};
+        if (iterations == 0) return result;
+
+        uint64_t total = 0;
+        for (const uint64_t ns : samples) total += ns;
+        std::ranges::sort(samples);
+
+        result.ns_mean = static_cast<double>(total) / iterations;
+        result.ns_p50 = samples[iterations / 2];
+        result.ns_p99 = samples[std::min<size_t>(iterations - 1, iterations * 99 / 100)];
+        result.ns_max = samples.back();
+        result.allocs_per_iter = static_cast<double>(measured.count) / iterations;
+        result.alloc_bytes_per_iter = static_cast<double>(measured.bytes) / iterations;
+        return result;
+    }
+
+    template <typename Fn>
+    Result run(std::string name, const uint32_t iterations, const uint32_t warmup, Fn&& fn)
+    {
+        return run(std::move(name), iterations, warmup, std::forward<Fn>(fn), [](uint32_t) {});
+    }
+
+    // Human-readable summary on stderr, the machine-readable report goes to stdout or a file
+    inline void print(const Result& r)
+    {
+        std::fprintf(stderr, "%-28s %10.0f ns/iter  p99 %9llu ns  %6.2f allocs/iter  %8.0f B/iter\n",
+                     r.name.c_str(), r.ns_mean, static_cast<unsigned long long>(r.ns_p99), r.allocs_per_iter,
+                     r.alloc_bytes_per_iter);
+    }
+
+    // Write {"benchmark": name, "tag": tag, "results": [...]} to path, or stdout when path is empty
+    inline bool writeReport(const std::string& path, const std::string& benchmark, const std::string& tag,
+                            const std::vector<Result>& results)
+    {
+        nlohmann::json report = {{"benchmark", benchmark}, {"tag", tag}, {"results", nlohmann::json::array()}};
+        for (const auto& r : results)
+        {
+            report["results"].push_back(r.toJson());
+        }
+
+        const std::string text = report.dump(2) + "\n";
+        std::FILE* file = path.empty() ? stdout : std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+            return false;
+        }
+
+        const bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        if (file != stdout) std::fclose(file);
+        return ok;
+    }
+}
+
+// The replacements below share one allocate/release pair, so every operator delete frees what an operator new
+// allocated through the same functions
+namespace bench::detail
+{
+    // GCC inlines these and then sees free() on a pointer that came from operator new. Every operator new here is
+    // malloc() underneath, so the pairing it warns about cannot happen.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+    inline void* allocate(const std::size_t size) noexcept
+    {
+        allocs.count++;
+        allocs.bytes += size;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    inline void release(void* p) noexcept
+    {
+        std::free(p);
+    }
+#pragma GCC diagnostic pop
+}
+
+void* operator new(const std::size_t size)
+{
+    if (void* p = bench::detail::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](const std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept
+{
+    return bench::detail::allocate(size);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+    bench::detail::release(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    bench::detail::release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    bench::detail::release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    bench::detail::release(p);
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "util/Blend.hpp"
+
+// Playlist's crossfade blend over a 4096 pixel frame for 2, 3 and 8 children, the per-pixel float blend it used before
+// against util::blend. max_channel_error compares the fixed-point result to the float one.
+
+static constexpr size_t PIXELS = 4096;
+
+namespace reference
+{
+    // The previous Playlist::render blend, apart from reading the children's frames from plain buffers
+    static void blend(const std::vector<std::vector<uint32_t>>& sources, const std::vector<float>& weights,
+                      uint32_t* dest)
+    {
+        float total_weight = 0.0f;
+        for (const float w : weights) total_weight += w;
+        if (total_weight <= 0.0f) return;
+
+        for (size_t i = 0; i < PIXELS; i++)
+        {
+            float r_sum = 0.0f, g_sum = 0.0f, b_sum = 0.0f;
+            for (size_t j = 0; j < sources.size(); j++)
+            {
+                if (weights[j] <= 0.0f) continue;
+                const uint32_t color = sources[j][i];
+                const float norm_weight = weights[j] / total_weight;
+                r_sum += static_cast<float>((color >> 16) & 0xFF) * norm_weight;
+                g_sum += static_cast<float>((color >> 8) & 0xFF) * norm_weight;
+                b_sum += static_cast<float>(color & 0xFF) * norm_weight;
+            }
+            dest[i] = static_cast<uint32_t>(r_sum + 0.5f) << 16 | static_cast<uint32_t>(g_sum + 0.5f) << 8 |
+                static_cast<uint32_t>(b_sum + 0.5f);
+        }
+    }
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --iterations N   timed frames per case (default 2000)\n"
+                 "  --json FILE      write the report to FILE instead of stdout\n"
+                 "  --tag TEXT       label stored in the report\n",
+                 argv0);
+}
+
+int main(const int argc, char** argv)
+{
+    uint32_t iterations = 2000;
+    std::string json_path;
+    std::string tag;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--iterations" && has_value) iterations = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--json" && has_value) json_path = argv[++i];
+        else if (arg == "--tag" && has_value) tag = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<uint32_t> pixel(0, 0xFFFFFF);
+    std::uniform_real_distribution<float> weight(0.05f, 1.0f);
+
+    std::vector<bench::Result> results;
+    for (const size_t children : {2, 3, 8})
+    {
+        std::vector<std::vector<uint32_t>> sources(children, std::vector<uint32_t>(PIXELS));
+        std::vector<float> weights(children);
+        for (size_t j = 0; j < children; j++)
+        {
+            for (auto& p : sources[j]) p = pixel(gen);
+            weights[j] = weight(gen);
+        }
+
+        std::vector<uint32_t> float_frame(PIXELS);
+        results.push_back(bench::run("float_blend_" + std::to_string(children), iterations, iterations / 10, [&]
+        {
+            reference::blend(sources, weights, float_frame.data());
+        }));
+
+        // As Playlist::render does it, the weights normalized once per frame
+        std::vector<uint32_t> fixed_frame(PIXELS);
+        std::vector<uint16_t> fixed_weights(children);
+        std::vector<const uint32_t*> pointers(children);
+        for (size_t j = 0; j < children; j++) pointers[j] = sources[j].data();
+
+        auto fixed = bench::run("fixed_blend_" + std::to_string(children), iterations, iterations / 10, [&]
+        {
+            util::blend::normalize(weights, fixed_weights);
+            util::blend::mix(pointers, fixed_weights, fixed_frame.data(), PIXELS);
+        });
+
+        int error = 0;
+        for (size_t i = 0; i < PIXELS; i++)
+        {
+            for (const int shift : {0, 8, 16})
+            {
+                error = std::max(error, std::abs(static_cast<int>((float_frame[i] >> shift) & 0xFF) -
+                                     static_cast<int>((fixed_frame[i] >> shift) & 0xFF)));
+            }
+        }
+        fixed.extra["max_channel_error"] = error;
+        results.push_back(fixed);
+    }
+
+    for (const auto& r : results) bench::print(r);
+
+    return bench::writeReport(json_path, "blend", tag, results) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "MatrixDriver.hpp"
+
+// MatrixEncoder, the I2S row encoding of MatrixDriver, on random frames: every row pair written at 8 and 4 bits per
+// channel, a frame with one changed pixel and an unchanged frame, which only cost the row hashes. reference_8bit
+// encodes plane by plane from the gamma and luminance tables, as the driver did before the fused plane table.
+// Longer chains (128x64, 256x64 and a 2x2 serpentine of 64x32 panels) run the same cases, suffixed with their size.
+
+using Encoder = MatrixEncoder<MatrixGeometry>;
+
+static constexpr size_t ROWS = Encoder::ROWS_PER_FRAME;
+static constexpr size_t COLS = Encoder::PIXELS_PER_ROW;
+static constexpr size_t DEPTH = Encoder::COLOR_DEPTH;
+
+namespace reference
+{
+    static void encode(const std::vector<uint32_t>& frame, const Encoder::CtrlBits& ctrl,
+                       const Encoder::RowBuffers& bufs)
+    {
+        for (size_t r = 0; r < ROWS; r++)
+        {
+            for (size_t d = 0; d < DEPTH; d++)
+            {
+                const int address = d == 0 ? static_cast<int>(r) - 1 : static_cast<int>(r);
+                const uint16_t mask = 1 << (d + DEPTH);
+                for (size_t c = 0; c < COLS; c++)
+                {
+                    const auto& pair = MatrixGeometry::MAP[r * COLS + c];
+                    const uint32_t top = frame[pair.top];
+                    const uint32_t bot = frame[pair.bot];
+
+                    uint16_t word = static_cast<uint16_t>(address << Encoder::BITS_ABCDE_OFFSET) | ctrl[d][c];
+                    if (Encoder::lumTbl[Encoder::gammaTbl[top >> 16 & 0xFF]] & mask) word |= Encoder::BIT_R1;
+                    if (Encoder::lumTbl[Encoder::gammaTbl[top >> 8 & 0xFF]] & mask) word |= Encoder::BIT_G1;
+                    if (Encoder::lumTbl[Encoder::gammaTbl[top & 0xFF]] & mask) word |= Encoder::BIT_B1;
+                    if (Encoder::lumTbl[Encoder::gammaTbl[bot >> 16 & 0xFF]] & mask) word |= Encoder::BIT_R2;
+                    if (Encoder::lumTbl[Encoder::gammaTbl[bot >> 8 & 0xFF]] & mask) word |= Encoder::BIT_G2;
+                    if (Encoder::lumTbl[Encoder::gammaTbl[bot & 0xFF]] & mask) word |= Encoder::BIT_B2;
+                    bufs[r * DEPTH + d][Encoder::xCoord(static_cast<int>(c))] = word;
+                }
+            }
+        }
+    }
+}
+
+// Row buffers and hashes of one set, with LAT on the last column like MatrixDriver::allocDmaBuffer() leaves them
+template <typename TEncoder>
+struct RowSet
+{
+    std::vector<uint16_t> words = std::vector<uint16_t>(TEncoder::ROWS_PER_FRAME * TEncoder::COLOR_DEPTH *
+                                                        TEncoder::PIXELS_PER_ROW);
+    typename TEncoder::RowBuffers bufs{};
+    typename TEncoder::RowHashes hashes{};
+    typename TEncoder::CtrlBits ctrl{};
+
+    RowSet()
+    {
+        for (size_t i = 0; i < bufs.size(); i++) bufs[i] = &words[i * TEncoder::PIXELS_PER_ROW];
+        for (auto& plane : ctrl) plane[TEncoder::PIXELS_PER_ROW - 1] = TEncoder::BIT_LAT;
+    }
+};
+
+template <typename TGeometry>
+static void benchGeometry(const std::string& suffix, const uint32_t iterations, std::mt19937& gen,
+                          std::vector<bench::Result>& results)
+{
+    using E = MatrixEncoder<TGeometry>;
+    std::uniform_int_distribution<uint32_t> pixel(0, 0xFFFFFF);
+
+    // Two frames alternated so that consecutive full encodes never hit the same data
+    std::vector<std::vector<uint32_t>> frames(2, std::vector<uint32_t>(TGeometry::SIZE));
+    for (auto& frame : frames)
+    {
+        for (auto& p : frame) p = pixel(gen);
+    }
+
+    RowSet<E> set;
+    uint32_t n = 0;
+
+    for (const uint8_t depth : {8, 4})
+    {
+        results.push_back(bench::run("encode_full_" + std::to_string(depth) + "bit" + suffix, iterations,
+                                     iterations / 10, [&]
+                                     {
+                                         E::encode(frames[n++ & 1].data(), depth, set.ctrl, set.bufs, set.hashes,
+                                                   true);
+                                     }));
+    }
+
+    // One pixel toggled per frame, a single row pair is written
+    std::vector<uint32_t>& frame = frames[0];
+    E::encode(frame.data(), E::COLOR_DEPTH, set.ctrl, set.bufs, set.hashes, true);
+    results.push_back(bench::run("encode_one_pixel" + suffix, iterations, iterations / 10, [&]
+    {
+        frame[n++ % frame.size()] ^= 1;
+        E::encode(frame.data(), E::COLOR_DEPTH, set.ctrl, set.bufs, set.hashes, false);
+    }));
+
+    results.push_back(bench::run("encode_unchanged" + suffix, iterations, iterations / 10, [&]
+    {
+        E::encode(frame.data(), E::COLOR_DEPTH, set.ctrl, set.bufs, set.hashes, false);
+    }));
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --iterations N   timed frames per case (default 2000)\n"
+                 "  --json FILE      write the report to FILE instead of stdout\n"
+                 "  --tag TEXT       label stored in the report\n",
+                 argv0);
+}
+
+int main(const int argc, char** argv)
+{
+    uint32_t iterations = 2000;
+    std::string json_path;
+    std::string tag;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--iterations" && has_value) iterations = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--json" && has_value) json_path = argv[++i];
+        else if (arg == "--tag" && has_value) tag = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937 gen(1);
+    std::vector<bench::Result> results;
+    benchGeometry<MatrixGeometry>("", iterations, gen, results);
+
+    // The per-plane encoder on the default panel
+    {
+        std::uniform_int_distribution<uint32_t> pixel(0, 0xFFFFFF);
+        std::vector<uint32_t> frame(MatrixGeometry::SIZE);
+        for (auto& p : frame) p = pixel(gen);
+
+        RowSet<Encoder> set;
+        results.push_back(bench::run("reference_8bit", iterations, iterations / 10, [&]
+        {
+            reference::encode(frame, set.ctrl, set.bufs);
+        }));
+    }
+
+    benchGeometry<PanelGeometry<64, 64, 2>>("_128x64", iterations, gen, results);
+    benchGeometry<PanelGeometry<64, 64, 4>>("_256x64", iterations, gen, results);
+    benchGeometry<PanelGeometry<64, 32, 4, PanelLayout::SERPENTINE, 2>>("_128x64_serpentine", iterations, gen,
+                                                                        results);
+
+    for (const auto& r : results) bench::print(r);
+
+    return bench::writeReport(json_path, "encoder", tag, results) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,278 @@
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "util/AudioFeatures.hpp"
+#include "util/Fft.hpp"
+#include "util/Filterbank.hpp"
+#include "util/Spectrum.hpp"
+
+// util::Fft, util::RealFft, util::Goertzel and the Q31 path against the recursive FFT and per-frame Hann window they replaced, at
+// the microphone's 512 points. max_abs_error compares each result to a double precision DFT of the same input.
+
+static constexpr size_t N = 512;
+using Complex = std::complex<float>;
+
+namespace reference
+{
+    // The previous util::fft, verbatim apart from the name
+    static void fft_recursive_impl(Complex* x_data, const size_t n, Complex* scratch_data)
+    {
+        if (n <= 1) return;
+
+        Complex* even_part_in_scratch = scratch_data;
+        Complex* odd_part_in_scratch = scratch_data + n / 2;
+
+        for (size_t i = 0; i < n / 2; i++)
+        {
+            even_part_in_scratch[i] = x_data[2 * i];
+            odd_part_in_scratch[i] = x_data[2 * i + 1];
+        }
+
+        fft_recursive_impl(even_part_in_scratch, n / 2, x_data);
+        fft_recursive_impl(odd_part_in_scratch, n / 2, x_data + n / 2);
+
+        for (size_t k = 0; k < n / 2; k++)
+        {
+            const float angle = -2.0f * M_PI * static_cast<float>(k) / static_cast<float>(n);
+            const Complex t = std::polar(1.0f, angle) * odd_part_in_scratch[k];
+
+            x_data[k] = even_part_in_scratch[k] + t;
+            x_data[k + n / 2] = even_part_in_scratch[k] - t;
+        }
+    }
+
+    static void fft(std::vector<Complex>& x)
+    {
+        std::vector<Complex> scratch(x.size());
+        fft_recursive_impl(x.data(), x.size(), scratch.data());
+    }
+
+    static std::vector<std::complex<double>> dft(const std::vector<Complex>& x)
+    {
+        std::vector<std::complex<double>> out(x.size());
+        for (size_t k = 0; k < x.size(); k++)
+        {
+            for (size_t n = 0; n < x.size(); n++)
+            {
+                out[k] += std::complex<double>(x[n]) * std::polar(1.0, -2.0 * M_PI * static_cast<double>(k * n) / x.size());
+            }
+        }
+        return out;
+    }
+}
+
+static double maxError(const std::vector<Complex>& got, const std::vector<std::complex<double>>& want)
+{
+    double error = 0;
+    for (size_t i = 0; i < got.size(); i++)
+    {
+        error = std::max(error, std::abs(std::complex<double>(got[i]) - want[i]));
+    }
+    return error;
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --iterations N   timed transforms per case (default 20000)\n"
+                 "  --json FILE      write the report to FILE instead of stdout\n"
+                 "  --tag TEXT       label stored in the report\n",
+                 argv0);
+}
+
+int main(const int argc, char** argv)
+{
+    uint32_t iterations = 20000;
+    std::string json_path;
+    std::string tag;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--iterations" && has_value) iterations = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--json" && has_value) json_path = argv[++i];
+        else if (arg == "--tag" && has_value) tag = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Microphone-like input, 16-bit samples scaled to [-1, 1)
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    std::vector<int32_t> samples(N);
+    for (auto& s : samples) s = dist(gen) << 16;
+
+    std::vector<Complex> input(N);
+    for (size_t i = 0; i < N; i++) input[i] = {static_cast<float>(samples[i] >> 16) / 32768.0f, 0.0f};
+    const auto exact = reference::dft(input);
+
+    std::vector<bench::Result> results;
+    std::vector<Complex> x(N);
+
+    auto old_fft = bench::run("recursive_fft_512", iterations, iterations / 10, [&]
+    {
+        x = input;
+        reference::fft(x);
+    });
+    old_fft.extra["max_abs_error"] = maxError(x, exact);
+    results.push_back(old_fft);
+
+    auto new_fft = bench::run("iterative_fft_512", iterations, iterations / 10, [&]
+    {
+        x = input;
+        util::Fft<N>::transform(std::span<Complex, N>(x));
+    });
+    new_fft.extra["max_abs_error"] = maxError(x, exact);
+    results.push_back(new_fft);
+
+    // Window, transform and the 64 magnitudes the microphone thread computes per frame
+    std::array<float, 64> magnitudes{};
+    results.push_back(bench::run("recursive_frame_512", iterations, iterations / 10, [&]
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            const float window = 0.5f * (1.0f - cosf(2.0f * M_PI * static_cast<float>(i) / static_cast<float>(N - 1)));
+            x[i] = {static_cast<float>(samples[i] >> 16) / 32768.0f * window, 0.0f};
+        }
+        reference::fft(x);
+        for (size_t i = 0; i < magnitudes.size(); i++) magnitudes[i] = std::abs(x[i]);
+    }));
+
+    results.push_back(bench::run("iterative_frame_512", iterations, iterations / 10, [&]
+    {
+        const auto& window = util::hann_window<N>();
+        for (size_t i = 0; i < N; i++)
+        {
+            x[i] = {static_cast<float>(samples[i] >> 16) / 32768.0f * window[i], 0.0f};
+        }
+        util::Fft<N>::transform(std::span<Complex, N>(x));
+        for (size_t i = 0; i < magnitudes.size(); i++) magnitudes[i] = std::abs(x[i]);
+    }));
+
+    // Real-input transform of the same samples, bins 0..N/2 compared to the exact spectrum
+    std::array<Complex, N / 2> half{};
+    auto real_fft = bench::run("real_fft_512", iterations, iterations / 10, [&]
+    {
+        for (size_t i = 0; i < N / 2; i++) half[i] = {input[2 * i].real(), input[2 * i + 1].real()};
+        util::RealFft<N>::transform(half);
+    });
+    {
+        double error = std::max(std::abs(half[0].real() - exact[0].real()),
+                                std::abs(half[0].imag() - exact[N / 2].real()));
+        for (size_t k = 1; k < N / 2; k++)
+        {
+            error = std::max(error, std::abs(std::complex<double>(half[k]) - exact[k]));
+        }
+        real_fft.extra["max_abs_error"] = error;
+    }
+    results.push_back(real_fft);
+
+    results.push_back(bench::run("real_frame_512", iterations, iterations / 10, [&]
+    {
+        const auto& window = util::hann_window<N>();
+        for (size_t i = 0; i < N / 2; i++)
+        {
+            half[i] = {static_cast<float>(samples[2 * i] >> 16) / 32768.0f * window[2 * i],
+                       static_cast<float>(samples[2 * i + 1] >> 16) / 32768.0f * window[2 * i + 1]};
+        }
+        util::RealFft<N>::transform(half);
+        for (size_t i = 0; i < magnitudes.size(); i++) magnitudes[i] = util::RealFft<N>::magnitude(half, i);
+    }));
+
+    // The microphone's spectrum analysers end to end, float against Q31
+    std::array<int32_t, N> sample_array{};
+    std::ranges::copy(samples, sample_array.begin());
+
+    util::FloatSpectrum<N> float_spectrum;
+    results.push_back(bench::run("float_spectrum_512", iterations, iterations / 10, [&]
+    {
+        float_spectrum.compute(sample_array, magnitudes);
+    }));
+
+    util::FixedSpectrum<N> fixed_spectrum;
+    results.push_back(bench::run("fixed_spectrum_512", iterations, iterations / 10, [&]
+    {
+        fixed_spectrum.compute(sample_array, magnitudes);
+    }));
+
+    // Folding all 256 bins into the 64 bands the microphone publishes
+    std::array<float, N / 2> all_bins{};
+    float_spectrum.compute(sample_array, all_bins);
+    for (const auto scale : {util::BandScale::LOG, util::BandScale::MEL})
+    {
+        const util::Filterbank<N / 2, 64> filterbank(scale, 22050.0f, 40.0f, 10000.0f);
+        results.push_back(bench::run(scale == util::BandScale::LOG ? "filterbank_log_64" : "filterbank_mel_64",
+                                     iterations, iterations / 10, [&]
+                                     {
+                                         filterbank.apply(all_bins, magnitudes);
+                                     }));
+    }
+
+    // Feature tracking per hop at the default 50% overlap on a 120 BPM pulse, the tempo autocorrelation every 16
+    // hops is amortized
+    util::AudioFeatureTracker<64> tracker(22050.0f / (N / 2));
+    util::AudioFeatures<64> features{};
+    std::array<float, 64> pulsed{};
+    uint32_t hop = 0;
+    results.push_back(bench::run("audio_features_64", iterations, iterations / 10, [&]
+    {
+        const float gain = hop++ % 43 < 2 ? 4.0f : 1.0f;
+        for (size_t i = 0; i < pulsed.size(); i++) pulsed[i] = magnitudes[i] * gain;
+        tracker.update(pulsed, features);
+    }));
+
+    // Goertzel for the 64 bins the microphone publishes, and for a handful
+    std::array<float, N> real_input{};
+    for (size_t i = 0; i < N; i++) real_input[i] = input[i].real();
+
+    const auto goertzelError = [&](const std::span<const float> got)
+    {
+        double error = 0;
+        for (size_t k = 0; k < got.size(); k++) error = std::max(error, std::abs(got[k] - std::abs(exact[k])));
+        return error;
+    };
+
+    auto goertzel_64 = bench::run("goertzel_64_of_512", iterations, iterations / 10, [&]
+    {
+        util::Goertzel<N, 64>::magnitudes(real_input, magnitudes);
+    });
+    goertzel_64.extra["max_abs_error"] = goertzelError(magnitudes);
+    results.push_back(goertzel_64);
+
+    std::array<float, 8> few{};
+    auto goertzel_8 = bench::run("goertzel_8_of_512", iterations, iterations / 10, [&]
+    {
+        util::Goertzel<N, 8>::magnitudes(real_input, few);
+    });
+    goertzel_8.extra["max_abs_error"] = goertzelError(few);
+    results.push_back(goertzel_8);
+
+    for (const auto& r : results) bench::print(r);
+
+    // Guard against a fast but wrong transform. Relative to the largest bin the float recursive FFT is at the 1e-7
+    // level on this input, Goertzel's long recurrences around 1e-4.
+    double peak = 0;
+    for (const auto& bin : exact) peak = std::max(peak, std::abs(bin));
+    for (const auto& r : results)
+    {
+        if (r.extra.contains("max_abs_error") && r.extra["max_abs_error"].get<double>() > 1e-3 * peak)
+        {
+            std::fprintf(stderr, "%s error %g too large\n", r.name.c_str(), r.extra["max_abs_error"].get<double>());
+            return EXIT_FAILURE;
+        }
+    }
+
+    return bench::writeReport(json_path, "fft", tag, results) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,187 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.hpp"
+#include "SimAudio.hpp"
+#include "Totem.hpp"
+
+#include "patterns/AudioSpectrumPattern.hpp"
+#include "patterns/LoadingPattern.hpp"
+#include "patterns/SinglePixelPattern.hpp"
+#include "patterns/SolidColorPattern.hpp"
+#include "playlists/DefaultPlaylist.hpp"
+#include "patterns/WifiConnectingPattern.hpp"
+
+// Renders every registered pattern the way the render thread does (clear, render) and reports per pattern:
+// ns/frame, heap allocations per frame and dirty_bytes_per_frame, the framebuffer bytes that differ from the previous
+// frame, i.e. what the encoder has to re-encode. Runs are deterministic: random patterns use a fixed seed and the
+// audio is released hop by hop in step with the frame clock.
+
+static constexpr auto TAG = "PatternBench";
+
+// Same reasoning as totem_sim, the microphone thread is never stopped
+[[noreturn]] static void quit(const int status)
+{
+    std::fflush(nullptr);
+    std::_Exit(status);
+}
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --frames N       timed frames per pattern (default 2000)\n"
+                 "  --warmup N       untimed frames rendered first (default 100)\n"
+                 "  --pattern NAME   only benchmark NAME, may be repeated\n"
+                 "  --json FILE      write the report to FILE instead of stdout\n"
+                 "  --tag TEXT       label stored in the report, e.g. the firmware version\n",
+                 argv0);
+}
+
+// Two seconds of three tones with a slow amplitude sweep, so the spectrum patterns have something to draw
+static std::vector<int32_t> testSignal(const uint32_t rate_hz)
+{
+    constexpr float TONES_HZ[] = {110.0f, 880.0f, 3520.0f};
+    constexpr float SWEEP_HZ = 0.5f;
+
+    std::vector<int32_t> samples(rate_hz * 2);
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const float t = static_cast<float>(i) / rate_hz;
+        float v = 0;
+        for (size_t k = 0; k < std::size(TONES_HZ); k++)
+        {
+            const float envelope = 0.5f + 0.5f * sinf(2.0f * M_PI * SWEEP_HZ * t + k * 2.0f);
+            v += envelope * sinf(2.0f * M_PI * TONES_HZ[k] * t) / std::size(TONES_HZ);
+        }
+        samples[i] = static_cast<int32_t>(v * 0x7FFFFF) << 8;
+    }
+    return samples;
+}
+
+// Release the hops captured by time_us one at a time and wait until each has been analysed, so every run shows the
+// same spectra at the same frames
+static void feedAudio(const int64_t time_us)
+{
+    static uint64_t fed = 0;
+    const uint64_t due = time_us * Microphone::SAMPLE_RATE / 1000000 / Microphone::HOP_SIZE;
+
+    for (; fed < due; fed++)
+    {
+        const uint32_t before = Microphone::getUpdateCount();
+        SimAudio::advance(Microphone::HOP_SIZE);
+
+        const int64_t deadline_us = esp_timer_get_time() + 1000000;
+        while (Microphone::getUpdateCount() == before)
+        {
+            if (esp_timer_get_time() > deadline_us)
+            {
+                ESP_LOGE(TAG, "Microphone did not analyse hop %llu", static_cast<unsigned long long>(fed));
+                quit(EXIT_FAILURE);
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    uint32_t frames = 2000;
+    uint32_t warmup = 100;
+    std::vector<std::string> only;
+    std::string json_path;
+    std::string tag;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--frames" && has_value) frames = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--warmup" && has_value) warmup = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--pattern" && has_value) only.emplace_back(argv[++i]);
+        else if (arg == "--json" && has_value) json_path = argv[++i];
+        else if (arg == "--tag" && has_value) tag = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            quit(EXIT_FAILURE);
+        }
+    }
+
+    // Every pattern in the tree, the cases below come from the registry
+    PatternRegistry::add_pattern<AudioSpectrumPattern>();
+    PatternRegistry::add_pattern<FirePattern>();
+    PatternRegistry::add_pattern<WifiConnectingPattern>();
+    PatternRegistry::add_pattern<DefaultPlaylist>();
+    PatternRegistry::add_pattern<LoadingPattern>();
+    PatternRegistry::add_pattern<SolidColorPattern>();
+    PatternRegistry::add_pattern<SinglePixelPattern>();
+
+    FirePattern::set_seed(1);
+    SimAudio::setSamples(testSignal(Microphone::SAMPLE_RATE), Microphone::SAMPLE_RATE);
+    SimAudio::setManual(true);
+    ESP_ERROR_CHECK(Microphone::start());
+    ESP_ERROR_CHECK(FramePool::init());
+
+    // A full window before the first frame, the frame clock continues across patterns
+    constexpr int64_t WINDOW_US = Microphone::BUFFER_SIZE * 1000000LL / Microphone::SAMPLE_RATE;
+    int64_t time_us = WINDOW_US + 1000;
+    feedAudio(time_us);
+
+    auto names = PatternRegistry::get_pattern_names();
+    std::ranges::sort(names);
+
+    std::vector<bench::Result> results;
+    for (const auto& name : names)
+    {
+        if (!only.empty() && std::ranges::find(only, name) == only.end()) continue;
+
+        const auto pattern = PatternRegistry::create_pattern(name);
+        std::array<uint32_t, MatrixDriver::SIZE> frame{};
+        std::array<uint32_t, MatrixDriver::SIZE> previous{};
+        pattern->bind(frame);
+        uint64_t dirty_bytes = 0;
+
+        // Frames at the default render tick, with the context built outside the timed part like Totem does
+        FrameContext ctx{};
+        ctx.time_us = time_us;
+        ctx.audio_update = Microphone::getAnalysis(ctx.audio);
+
+        auto result = bench::run(name, frames, warmup, [&]
+        {
+            pattern->clear();
+            pattern->render(ctx);
+        }, [&](uint32_t)
+        {
+            ctx.dt_us = pdTICKS_TO_MS(PatternBase::DEFAULT_RENDER_TICK) * 1000;
+            ctx.time_us += ctx.dt_us;
+            ctx.index++;
+            feedAudio(ctx.time_us);
+            ctx.audio_update = Microphone::getAnalysis(ctx.audio);
+
+            for (size_t i = 0; i < previous.size(); i++)
+            {
+                dirty_bytes += previous[i] != frame[i] ? sizeof(uint32_t) : 0;
+            }
+            previous = frame;
+        });
+
+        time_us = ctx.time_us;
+        result.extra["dirty_bytes_per_frame"] = frames > 0 ? static_cast<double>(dirty_bytes) / frames : 0.0;
+        bench::print(result);
+        results.push_back(std::move(result));
+    }
+
+    if (results.empty())
+    {
+        ESP_LOGE(TAG, "No pattern matched");
+        quit(EXIT_FAILURE);
+    }
+
+    quit(bench::writeReport(json_path, "patterns", tag, results) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Playlist.hpp"
+#include "patterns/SolidColorPattern.hpp"
+
+// A show-length playlist of 1,000 overlapping cues: per-frame cost drawn and hidden (time keeping and active children
+// only), the cost of seeking to a random point, and how many bytes of children are built at most.
+
+static constexpr uint32_t CUES = 1000;
+static constexpr uint32_t SHOW_MS = 60 * 60 * 1000;
+
+// One cue every 3.6 s, each on for three slots and cross-faded over one second, so three or four are active
+class ShowPlaylist final : public Playlist
+{
+public:
+    ShowPlaylist() : Playlist("ShowPlaylist")
+    {
+        set_total_time(SHOW_MS);
+        for (uint32_t i = 0; i < CUES; i++)
+        {
+            const uint32_t start_ms = i * (SHOW_MS / CUES);
+            add_pattern<SolidColorPattern>(start_ms, std::min(start_ms + 3 * (SHOW_MS / CUES), SHOW_MS), 1000,
+                                           static_cast<uint8_t>(i), static_cast<uint8_t>(i * 7),
+                                           static_cast<uint8_t>(i * 13));
+        }
+    }
+
+    void seek(const uint32_t time_ms)
+    {
+        set_start_time(time_ms);
+    }
+};
+
+static void usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --frames N       timed frames per case (default 5000)\n"
+                 "  --json FILE      write the report to FILE instead of stdout\n"
+                 "  --tag TEXT       label stored in the report\n",
+                 argv0);
+}
+
+int main(const int argc, char** argv)
+{
+    uint32_t frames = 5000;
+    std::string json_path;
+    std::string tag;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--frames" && has_value) frames = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--json" && has_value) json_path = argv[++i];
+        else if (arg == "--tag" && has_value) tag = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ESP_ERROR_CHECK(FramePool::init());
+
+    std::array<uint32_t, MatrixDriver::SIZE> frame{};
+    ShowPlaylist playlist;
+    playlist.bind(frame);
+    std::vector<bench::Result> results;
+
+    // Frames at the default render tick, fast forwarded 3 s between samples so the run crosses many cues
+    FrameContext ctx{};
+    ctx.dt_us = pdTICKS_TO_MS(PatternBase::DEFAULT_RENDER_TICK) * 1000;
+    size_t peak_resident_bytes = 0;
+    const auto step = [&](uint32_t)
+    {
+        FrameContext skip = ctx;
+        skip.dt_us = 3000 * 1000;
+        playlist.tick(skip);
+        peak_resident_bytes = std::max(peak_resident_bytes, playlist.get_resident_bytes());
+    };
+
+    auto render = bench::run("render_1000_cues", frames, frames / 10, [&]
+    {
+        playlist.render(ctx);
+    }, step);
+    render.extra["peak_resident_bytes"] = peak_resident_bytes;
+    results.push_back(render);
+
+    results.push_back(bench::run("tick_1000_cues", frames, frames / 10, [&]
+    {
+        playlist.tick(ctx);
+    }, step));
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<uint32_t> time(0, SHOW_MS - 1);
+    results.push_back(bench::run("seek_1000_cues", frames, frames / 10, [&]
+    {
+        playlist.seek(time(gen));
+        playlist.tick(ctx);
+    }));
+
+    for (const auto& r : results) bench::print(r);
+
+    return bench::writeReport(json_path, "playlist", tag, results) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "SimAudio.hpp"
+
+// Standard-mode RX channels backed by SimAudio, so Microphone runs unchanged on the host
+using i2s_chan_handle_t = struct i2s_channel_obj_t*;
+
+enum i2s_port_t { I2S_NUM_0, I2S_NUM_1, I2S_NUM_AUTO };
+enum i2s_role_t { I2S_ROLE_MASTER, I2S_ROLE_SLAVE };
+enum i2s_data_bit_width_t
+{
+    I2S_DATA_BIT_WIDTH_8BIT = 8,
+    I2S_DATA_BIT_WIDTH_16BIT = 16,
+    I2S_DATA_BIT_WIDTH_24BIT = 24,
+    I2S_DATA_BIT_WIDTH_32BIT = 32,
+};
+enum i2s_slot_mode_t { I2S_SLOT_MODE_MONO = 1, I2S_SLOT_MODE_STEREO = 2 };
+
+#define I2S_GPIO_UNUSED GPIO_NUM_NC
+
+struct i2s_chan_config_t
+{
+    i2s_port_t id;
+    i2s_role_t role;
+    uint32_t dma_desc_num;
+    uint32_t dma_frame_num;
+    bool auto_clear;
+    bool auto_clear_before_cb;
+    bool allow_pd;
+    int intr_priority;
+};
+
+struct i2s_std_clk_config_t
+{
+    uint32_t sample_rate_hz;
+};
+
+struct i2s_std_slot_config_t
+{
+    i2s_data_bit_width_t data_bit_width;
+    i2s_slot_mode_t slot_mode;
+};
+
+struct i2s_std_gpio_config_t
+{
+    gpio_num_t mclk;
+    gpio_num_t bclk;
+    gpio_num_t ws;
+    gpio_num_t dout;
+    gpio_num_t din;
+
+    struct
+    {
+        bool mclk_inv;
+        bool bclk_inv;
+        bool ws_inv;
+    } invert_flags;
+};
+
+struct i2s_std_config_t
+{
+    i2s_std_clk_config_t clk_cfg;
+    i2s_std_slot_config_t slot_cfg;
+    i2s_std_gpio_config_t gpio_cfg;
+};
+
+#define I2S_STD_CLK_DEFAULT_CONFIG(rate) {.sample_rate_hz = (rate)}
+#define I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(bits, mode) {.data_bit_width = (bits), .slot_mode = (mode)}
+
+struct i2s_event_data_t
+{
+    void* dma_buf;
+    size_t size;
+};
+
+using i2s_isr_callback_t = bool (*)(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+
+struct i2s_event_callbacks_t
+{
+    i2s_isr_callback_t on_recv;
+    i2s_isr_callback_t on_recv_q_ovf;
+    i2s_isr_callback_t on_sent;
+    i2s_isr_callback_t on_send_q_ovf;
+};
+
+struct i2s_channel_obj_t
+{
+    uint32_t dma_samples = 0;
+    uint32_t dma_frame_num = 0;
+    uint32_t sample_rate_hz = 0;
+    SimAudio::Stream stream;
+    i2s_event_callbacks_t callbacks{};
+    void* user_ctx = nullptr;
+    // Stands in for the DMA interrupt while callbacks are registered
+    std::thread dma_thread;
+    std::atomic<bool> enabled{false};
+};
+
+inline esp_err_t i2s_new_channel(const i2s_chan_config_t* config, i2s_chan_handle_t* tx, i2s_chan_handle_t* rx)
+{
+    if (tx != nullptr) return ESP_ERR_NOT_SUPPORTED;
+    if (rx == nullptr) return ESP_ERR_INVALID_ARG;
+    *rx = new i2s_channel_obj_t();
+    (*rx)->dma_samples = config->dma_desc_num * config->dma_frame_num;
+    (*rx)->dma_frame_num = config->dma_frame_num;
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_channel_init_std_mode(const i2s_chan_handle_t handle, const i2s_std_config_t* config)
+{
+    handle->sample_rate_hz = config->clk_cfg.sample_rate_hz;
+    return ESP_OK;
+}
+
+// Like the driver, only allowed before the channel is enabled
+inline esp_err_t i2s_channel_register_event_callback(const i2s_chan_handle_t handle,
+                                                     const i2s_event_callbacks_t* callbacks, void* user_ctx)
+{
+    if (handle->enabled.load()) return ESP_ERR_INVALID_STATE;
+    handle->callbacks = callbacks != nullptr ? *callbacks : i2s_event_callbacks_t{};
+    handle->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_channel_enable(const i2s_chan_handle_t handle)
+{
+    if (handle->enabled.exchange(true)) return ESP_ERR_INVALID_STATE;
+    handle->stream = SimAudio::openStream(handle->sample_rate_hz, handle->dma_samples);
+
+    if (handle->callbacks.on_recv != nullptr)
+    {
+        // Hands each DMA buffer's worth of samples to on_recv as it "completes", like the receive interrupt
+        handle->dma_thread = std::thread([handle]
+        {
+            std::vector<int32_t> dma_buf(handle->dma_frame_num);
+            while (handle->enabled.load())
+            {
+                const size_t samples = SimAudio::read(handle->stream, dma_buf.data(), dma_buf.size(), 100);
+                if (samples < dma_buf.size()) continue;
+
+                i2s_event_data_t event{dma_buf.data(), samples * sizeof(int32_t)};
+                handle->callbacks.on_recv(handle, &event, handle->user_ctx);
+                std::this_thread::yield();
+            }
+        });
+    }
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_channel_disable(const i2s_chan_handle_t handle)
+{
+    if (!handle->enabled.exchange(false)) return ESP_ERR_INVALID_STATE;
+    if (handle->dma_thread.joinable()) handle->dma_thread.join();
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_del_channel(const i2s_chan_handle_t handle)
+{
+    if (handle->enabled.load()) return ESP_ERR_INVALID_STATE;
+    delete handle;
+    return ESP_OK;
+}
+
+// Reads 32-bit mono samples, blocking like the DMA would until they have "arrived"
+inline esp_err_t i2s_channel_read(const i2s_chan_handle_t handle, void* dest, const size_t size, size_t* bytes_read,
+                                  const uint32_t timeout_ms)
+{
+    const size_t samples = SimAudio::read(handle->stream, static_cast<int32_t*>(dest), size / sizeof(int32_t),
+                                          timeout_ms);
+    if (bytes_read) *bytes_read = samples * sizeof(int32_t);
+    return samples > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Nanoseconds stand in for CPU cycles, sdkconfig.h sets the matching 1000 MHz clock
+inline uint32_t esp_cpu_get_cycle_count()
+{
+    return static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
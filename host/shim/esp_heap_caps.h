@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+inline void* heap_caps_malloc(const size_t size, uint32_t)
+{
+    return std::malloc(size);
+}
+
+inline void* heap_caps_calloc(const size_t n, const size_t size, uint32_t)
+{
+    return std::calloc(n, size);
+}
+
+inline void heap_caps_free(void* ptr)
+{
+    std::free(ptr);
+}
+
+// The host has no meaningful limit, report something larger than any request the firmware makes
+inline size_t heap_caps_get_largest_free_block(uint32_t)
+{
+    return 4 * 1024 * 1024;
+}
+
+inline size_t heap_caps_get_free_size(uint32_t)
+{
+    return 4 * 1024 * 1024;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <sys/types.h>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+// Enough of the HTTP server API for headers that mention it to compile, RestServer is not built on the host
+using httpd_handle_t = void*;
+
+struct httpd_req_t
+{
+    size_t content_len;
+    void* user_ctx;
+};
+
+enum httpd_method_t { HTTP_GET, HTTP_POST };
+
+enum httpd_err_code_t
+{
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_413_CONTENT_TOO_LARGE,
+    HTTPD_500_INTERNAL_SERVER_ERROR,
+};
+
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+inline esp_err_t httpd_resp_send_err(httpd_req_t*, httpd_err_code_t, const char*)
+{
+    return ESP_FAIL;
+}
+
+inline int httpd_req_recv(httpd_req_t*, char*, size_t)
+{
+    return -1;
+}
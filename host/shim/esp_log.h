@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#define ESP_HOST_LOG(letter, tag, fmt, ...) \
+    std::fprintf(stderr, letter " (%" PRId64 ") %s: " fmt "\n", esp_timer_get_time() / 1000, tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_HOST_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_HOST_LOG("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) static_cast<void>(0)
+#define ESP_LOGV(tag, fmt, ...) static_cast<void>(0)
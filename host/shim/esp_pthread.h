@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+// Core pinning, priorities and stack sizes are firmware concerns, host threads take the OS defaults
+struct esp_pthread_cfg_t
+{
+    size_t stack_size;
+    size_t prio;
+    bool inherit_cfg;
+    const char* thread_name;
+    int pin_to_core;
+    uint32_t stack_alloc_caps;
+};
+
+inline esp_pthread_cfg_t esp_pthread_get_default_config()
+{
+    return {4096, 5, false, nullptr, -1, 0};
+}
+
+inline esp_err_t esp_pthread_set_cfg(const esp_pthread_cfg_t*)
+{
+    return ESP_OK;
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sdkconfig.h"
+
+// The slice of the FreeRTOS API the firmware uses, on top of std::thread primitives. Ticks are milliseconds.
+using TickType_t = uint32_t;
+using BaseType_t = int;
+using UBaseType_t = unsigned;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY static_cast<TickType_t>(0xffffffffUL)
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(static_cast<uint64_t>(ms) * configTICK_RATE_HZ / 1000))
+#define pdTICKS_TO_MS(ticks) (static_cast<uint32_t>(static_cast<uint64_t>(ticks) * 1000 / configTICK_RATE_HZ))
+#define tskNO_AFFINITY 0x7fffffff
+#define portYIELD_FROM_ISR(...) static_cast<void>(0)
+
+namespace freertos_host
+{
+    inline std::chrono::steady_clock::time_point boot()
+    {
+        static const auto boot = std::chrono::steady_clock::now();
+        return boot;
+    }
+
+    inline std::chrono::steady_clock::time_point tickTime(const TickType_t tick)
+    {
+        return boot() + std::chrono::milliseconds(pdTICKS_TO_MS(tick));
+    }
+
+    // Counting semaphore, binary when max_count is 1
+    struct Semaphore
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        UBaseType_t count = 0;
+        UBaseType_t max_count = 1;
+    };
+
+    // Per-thread state behind a TaskHandle_t, only the notification counter so far
+    struct Task
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint32_t notifications = 0;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::vector<uint8_t>> items;
+        UBaseType_t length;
+        UBaseType_t item_size;
+    };
+
+    // Waits on cv until pred holds or the timeout in ticks expires
+    template <typename TPred>
+    bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const TickType_t ticks, TPred pred)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            cv.wait(lock, pred);
+            return true;
+        }
+        return cv.wait_for(lock, std::chrono::milliseconds(pdTICKS_TO_MS(ticks)), pred);
+    }
+}
+
+using TaskHandle_t = void*;
+using SemaphoreHandle_t = freertos_host::Semaphore*;
+using QueueHandle_t = freertos_host::Queue*;
+
+inline TickType_t xTaskGetTickCount()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - freertos_host::boot();
+    return pdMS_TO_TICKS(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+inline void vTaskDelay(const TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+
+inline BaseType_t xTaskDelayUntil(TickType_t* previous_wake, const TickType_t increment)
+{
+    const TickType_t wake = *previous_wake + increment;
+    *previous_wake = wake;
+    if (static_cast<int32_t>(wake - xTaskGetTickCount()) <= 0)
+    {
+        return pdFALSE;
+    }
+    std::this_thread::sleep_until(freertos_host::tickTime(wake));
+    return pdTRUE;
+}
+
+inline void vTaskDelayUntil(TickType_t* previous_wake, const TickType_t increment)
+{
+    xTaskDelayUntil(previous_wake, increment);
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    static thread_local freertos_host::Task self;
+    return &self;
+}
+
+inline BaseType_t xTaskNotifyGive(const TaskHandle_t handle)
+{
+    const auto task = static_cast<freertos_host::Task*>(handle);
+    {
+        std::lock_guard lock(task->mutex);
+        task->notifications++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+inline void vTaskNotifyGiveFromISR(const TaskHandle_t handle, BaseType_t* higher_priority_task_woken)
+{
+    if (higher_priority_task_woken) *higher_priority_task_woken = pdFALSE;
+    xTaskNotifyGive(handle);
+}
+
+// Returns the notification count before the take, 0 if the timeout expired first
+inline uint32_t ulTaskNotifyTake(const BaseType_t clear_on_exit, const TickType_t ticks)
+{
+    const auto task = static_cast<freertos_host::Task*>(xTaskGetCurrentTaskHandle());
+    std::unique_lock lock(task->mutex);
+    if (!freertos_host::waitFor(task->cv, lock, ticks, [task] { return task->notifications > 0; }))
+    {
+        return 0;
+    }
+    const uint32_t count = task->notifications;
+    task->notifications = clear_on_exit ? 0 : count - 1;
+    return count;
+}
+
+// Host threads have no fixed stack to watch
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t)
+{
+    return 0;
+}
+
+inline BaseType_t xPortGetCoreID()
+{
+    return 0;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(const UBaseType_t max_count, const UBaseType_t initial_count)
+{
+    const auto sem = new freertos_host::Semaphore();
+    sem->max_count = max_count;
+    sem->count = initial_count;
+    return sem;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+inline BaseType_t xSemaphoreTake(const SemaphoreHandle_t sem, const TickType_t ticks)
+{
+    std::unique_lock lock(sem->mutex);
+    if (!freertos_host::waitFor(sem->cv, lock, ticks, [sem] { return sem->count > 0; }))
+    {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(const SemaphoreHandle_t sem)
+{
+    {
+        std::lock_guard lock(sem->mutex);
+        if (sem->count >= sem->max_count) return pdFALSE;
+        sem->count++;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveFromISR(const SemaphoreHandle_t sem, BaseType_t* higher_priority_task_woken)
+{
+    if (higher_priority_task_woken) *higher_priority_task_woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+inline void vSemaphoreDelete(const SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+inline QueueHandle_t xQueueCreate(const UBaseType_t length, const UBaseType_t item_size)
+{
+    const auto queue = new freertos_host::Queue();
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+inline BaseType_t xQueueSend(const QueueHandle_t queue, const void* item, const TickType_t ticks)
+{
+    {
+        std::unique_lock lock(queue->mutex);
+        if (!freertos_host::waitFor(queue->cv, lock, ticks, [queue] { return queue->items.size() < queue->length; }))
+        {
+            return pdFALSE;
+        }
+        const auto bytes = static_cast<const uint8_t*>(item);
+        queue->items.emplace_back(bytes, bytes + queue->item_size);
+    }
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(const QueueHandle_t queue, void* item, const TickType_t ticks)
+{
+    {
+        std::unique_lock lock(queue->mutex);
+        if (!freertos_host::waitFor(queue->cv, lock, ticks, [queue] { return !queue->items.empty(); }))
+        {
+            return pdFALSE;
+        }
+        std::memcpy(item, queue->items.front().data(), queue->item_size);
+        queue->items.pop_front();
+    }
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+inline void vQueueDelete(const QueueHandle_t queue)
+{
+    delete queue;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Forced into every host translation unit. The firmware toolchain reaches these through its own headers.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ranges>
+#include <string>
+
+#if defined(__GLIBCXX__) && __GNUC__ < 14
+namespace std
+{
+    using ::sqrtf;
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+// Configuration for host builds, the firmware gets the generated sdkconfig.h instead
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+// Host cycle counts are nanoseconds, see esp_cpu.h
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 1000
+
+#ifndef CONFIG_TOTEM_METRICS
+#define CONFIG_TOTEM_METRICS 0
+#endif
+
+#ifndef CONFIG_TOTEM_MIC_SPECTRUM_GOERTZEL
+#define CONFIG_TOTEM_MIC_SPECTRUM_GOERTZEL 0
+#endif
+
+#ifndef CONFIG_TOTEM_MIC_FIXED_POINT
+#define CONFIG_TOTEM_MIC_FIXED_POINT 0
+#endif
+
+#if !defined(CONFIG_TOTEM_MIC_BANDS_LINEAR) && !defined(CONFIG_TOTEM_MIC_BANDS_MEL)
+#define CONFIG_TOTEM_MIC_BANDS_LOG 1
+#endif
+
+#ifndef CONFIG_TOTEM_MIC_OVERLAP_PERCENT
+#define CONFIG_TOTEM_MIC_OVERLAP_PERCENT 50
+#endif
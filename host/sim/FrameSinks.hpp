@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MatrixDriver.hpp"
+
+// Ready-made MatrixDriver::FrameSink implementations for the host simulator
+namespace sim
+{
+    // One binary PPM per frame, <dir>/frame_00000.ppm onwards. Pixels are written exactly as rendered.
+    inline MatrixDriver::FrameSink ppmSink(std::string dir)
+    {
+        return [dir = std::move(dir)](const MatrixDriver::Frame& frame, const uint32_t index, uint8_t, uint8_t)
+        {
+            char path[512];
+            std::snprintf(path, sizeof(path), "%s/frame_%05u.ppm", dir.c_str(), index);
+
+            std::FILE* file = std::fopen(path, "wb");
+            if (file == nullptr) return;
+
+            std::fprintf(file, "P6\n%u %u\n255\n", MatrixDriver::WIDTH, MatrixDriver::HEIGHT);
+            std::vector<uint8_t> rgb(frame.size() * 3);
+            for (size_t i = 0; i < frame.size(); i++)
+            {
+                rgb[i * 3 + 0] = frame[i] >> 16 & 0xFF;
+                rgb[i * 3 + 1] = frame[i] >> 8 & 0xFF;
+                rgb[i * 3 + 2] = frame[i] & 0xFF;
+            }
+            std::fwrite(rgb.data(), 1, rgb.size(), file);
+            std::fclose(file);
+        };
+    }
+
+    // All frames appended to one file as raw 0x00RRGGBB little-endian words, WIDTH * HEIGHT per frame
+    inline MatrixDriver::FrameSink rawSink(const std::string& path)
+    {
+        std::shared_ptr<std::FILE> file(std::fopen(path.c_str(), "wb"), [](std::FILE* f) { if (f) std::fclose(f); });
+        return [file](const MatrixDriver::Frame& frame, uint32_t, uint8_t, uint8_t)
+        {
+            if (!file) return;
+            std::fwrite(frame.data(), sizeof(uint32_t), frame.size(), file.get());
+            std::fflush(file.get());
+        };
+    }
+
+    // Keeps every frame in memory, for tests that inspect output directly
+    struct MemorySink
+    {
+        std::vector<MatrixDriver::Frame> frames;
+
+        MatrixDriver::FrameSink sink()
+        {
+            return [this](const MatrixDriver::Frame& frame, uint32_t, uint8_t, uint8_t) { frames.push_back(frame); };
+        }
+    };
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/**
+ * @brief Audio source behind the host I2S RX shim
+ *
+ * Samples come from a WAV file looped forever, or silence when none is loaded. They are delivered in the INMP441
+ * format, 24-bit signed left-justified in 32 bits. In real-time mode reads block until the samples would have been
+ * captured, otherwise they return immediately so benchmarks run at full host speed. In manual mode they block until
+ * advance() releases the samples, so a caller decides exactly which audio has arrived by each frame.
+ */
+class SimAudio final
+{
+    static constexpr auto TAG = "SimAudio";
+
+    static std::vector<int32_t> samples_;
+    static uint32_t sample_rate_hz_;
+    static std::atomic<bool> realtime_;
+    static std::atomic<bool> manual_;
+    static std::atomic<uint64_t> released_; // Stream position manual reads may reach
+
+    struct WavFormat
+    {
+        uint16_t format;
+        uint16_t channels;
+        uint32_t sample_rate;
+        uint16_t bits_per_sample;
+    };
+
+    template <typename T>
+    static bool readLe(std::FILE* file, T& value)
+    {
+        uint8_t bytes[sizeof(T)];
+        if (std::fread(bytes, 1, sizeof(T), file) != sizeof(T)) return false;
+        value = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            value |= static_cast<T>(bytes[i]) << (8 * i);
+        }
+        return true;
+    }
+
+    // First channel of an integer PCM frame, left-justified to 32 bits
+    static int32_t decodeSample(const uint8_t* frame, const uint16_t bits_per_sample)
+    {
+        const uint8_t bytes = bits_per_sample / 8;
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint32_t>(frame[i]) << (8 * (4 - bytes + i));
+        }
+        if (bytes == 1) value ^= 0x80000000; // 8-bit WAV is unsigned
+        return static_cast<int32_t>(value);
+    }
+
+public:
+    SimAudio() = delete;
+
+    // Position of one reader in the sample stream
+    struct Stream
+    {
+        uint32_t rate_hz = 0;
+        // Samples the DMA ring holds, a real-time reader that falls further behind loses the oldest ones
+        uint32_t backlog = 0;
+        uint64_t position = 0;
+        int64_t start_us = 0;
+    };
+
+    // Load a PCM WAV file with 8, 16, 24 or 32-bit integer samples, extra channels are ignored
+    static esp_err_t loadWav(const std::string& path)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            ESP_LOGE(TAG, "Cannot open %s", path.c_str());
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        char id[4];
+        uint32_t chunk_size = 0;
+        WavFormat fmt{};
+        bool have_fmt = false;
+        esp_err_t err = ESP_ERR_INVALID_ARG;
+
+        if (std::fread(id, 1, 4, file) != 4 || std::string(id, 4) != "RIFF" || !readLe(file, chunk_size) ||
+            std::fread(id, 1, 4, file) != 4 || std::string(id, 4) != "WAVE")
+        {
+            ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+            std::fclose(file);
+            return err;
+        }
+
+        while (std::fread(id, 1, 4, file) == 4 && readLe(file, chunk_size))
+        {
+            const std::string chunk(id, 4);
+            if (chunk == "fmt ")
+            {
+                uint32_t byte_rate;
+                uint16_t block_align;
+                have_fmt = readLe(file, fmt.format) && readLe(file, fmt.channels) && readLe(file, fmt.sample_rate) &&
+                    readLe(file, byte_rate) && readLe(file, block_align) && readLe(file, fmt.bits_per_sample);
+                std::fseek(file, static_cast<long>(chunk_size) - 16, SEEK_CUR);
+            }
+            else if (chunk == "data" && have_fmt)
+            {
+                // 1 = integer PCM, 0xFFFE = WAVE_FORMAT_EXTENSIBLE, assumed to carry integer PCM too
+                if ((fmt.format != 1 && fmt.format != 0xFFFE) || fmt.bits_per_sample % 8 != 0 ||
+                    fmt.bits_per_sample == 0 || fmt.bits_per_sample > 32 || fmt.channels == 0)
+                {
+                    ESP_LOGE(TAG, "%s: only integer PCM is supported", path.c_str());
+                    break;
+                }
+
+                const size_t frame_bytes = fmt.bits_per_sample / 8 * fmt.channels;
+                std::vector<uint8_t> data(chunk_size);
+                data.resize(std::fread(data.data(), 1, chunk_size, file));
+
+                std::vector<int32_t> samples(data.size() / frame_bytes);
+                for (size_t i = 0; i < samples.size(); i++)
+                {
+                    samples[i] = decodeSample(&data[i * frame_bytes], fmt.bits_per_sample);
+                }
+
+                samples_ = std::move(samples);
+                sample_rate_hz_ = fmt.sample_rate;
+                ESP_LOGI(TAG, "Loaded %zu samples at %u Hz from %s", samples_.size(), sample_rate_hz_, path.c_str());
+                err = ESP_OK;
+                break;
+            }
+            else
+            {
+                std::fseek(file, chunk_size + (chunk_size & 1), SEEK_CUR);
+            }
+        }
+
+        std::fclose(file);
+        return err;
+    }
+
+    // Use generated samples (24-bit left-justified like the INMP441) instead of a file, looped like one
+    static void setSamples(std::vector<int32_t> samples, const uint32_t sample_rate_hz)
+    {
+        samples_ = std::move(samples);
+        sample_rate_hz_ = sample_rate_hz;
+    }
+
+    // Pace reads to the wall clock like a live microphone (the default), or deliver samples as fast as requested
+    static void setRealtime(const bool realtime)
+    {
+        realtime_.store(realtime);
+    }
+
+    // Deliver samples only as advance() releases them, overrides real-time pacing
+    static void setManual(const bool manual)
+    {
+        manual_.store(manual);
+    }
+
+    // Release the next samples to manual readers, counted at the stream rate
+    static void advance(const uint64_t samples)
+    {
+        released_.fetch_add(samples);
+    }
+
+    static Stream openStream(const uint32_t rate_hz, const uint32_t backlog)
+    {
+        return {rate_hz, backlog, 0, esp_timer_get_time()};
+    }
+
+    // Fill dest with up to count samples, resampled to the stream rate by nearest neighbour. Returns how many
+    // samples were delivered, fewer than count only if the timeout expired first.
+    static size_t read(Stream& stream, int32_t* dest, const size_t count, const uint32_t timeout_ms)
+    {
+        size_t available = count;
+        if (manual_.load())
+        {
+            // Whole requests only, like a DMA buffer that has not filled yet
+            const int64_t deadline_us = esp_timer_get_time() + static_cast<int64_t>(timeout_ms) * 1000;
+            while (released_.load() < stream.position + count)
+            {
+                if (esp_timer_get_time() >= deadline_us) return 0;
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        else if (realtime_.load())
+        {
+            const int64_t deadline_us = esp_timer_get_time() + static_cast<int64_t>(timeout_ms) * 1000;
+            const int64_t ready_us = stream.start_us +
+                static_cast<int64_t>((stream.position + count) * 1000000 / stream.rate_hz);
+
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min(ready_us, deadline_us) -
+                esp_timer_get_time()));
+
+            const auto captured = static_cast<uint64_t>(
+                (esp_timer_get_time() - stream.start_us) * static_cast<int64_t>(stream.rate_hz) / 1000000);
+            if (captured > stream.position + stream.backlog)
+            {
+                stream.position = captured - stream.backlog;
+            }
+            available = std::min<uint64_t>(count, captured > stream.position ? captured - stream.position : 0);
+        }
+
+        for (size_t i = 0; i < available; i++)
+        {
+            if (samples_.empty())
+            {
+                dest[i] = 0;
+                continue;
+            }
+
+            const uint64_t source = (stream.position + i) * sample_rate_hz_ / stream.rate_hz;
+            dest[i] = samples_[source % samples_.size()];
+        }
+
+        stream.position += available;
+        return available;
+    }
+};
+
+std::vector<int32_t> SimAudio::samples_;
+uint32_t SimAudio::sample_rate_hz_ = 0;
+std::atomic<bool> SimAudio::realtime_{true};
+std::atomic<bool> SimAudio::manual_{false};
+std::atomic<uint64_t> SimAudio::released_{0};
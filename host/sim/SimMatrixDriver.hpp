@@ -0,0 +1,221 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Host stand-in for the I2S/DMA MatrixDriver
+ *
+ * Same interface and frame semantics as the firmware driver: frames are written to a back buffer, flipped in at the
+ * next frame boundary and unchanged row pairs are counted as skipped. Instead of being scanned out, every flipped
+ * frame is handed to a FrameSink.
+ */
+class MatrixDriver final
+{
+public:
+    using Geometry = MatrixGeometry;
+
+    static constexpr uint16_t WIDTH = Geometry::WIDTH;
+    static constexpr uint16_t HEIGHT = Geometry::HEIGHT;
+    static constexpr uint16_t SIZE = Geometry::SIZE;
+    static constexpr uint32_t BUF_SIZE = SIZE * sizeof(uint32_t);
+
+    static constexpr uint8_t MIN_COLOR_DEPTH = 4;
+    static constexpr uint8_t MAX_COLOR_DEPTH = 8;
+
+    using Frame = std::array<uint32_t, SIZE>;
+    // Receives each displayed frame with its sequence number, brightness and color depth at the time of the flip
+    using FrameSink = std::function<void(const Frame& frame, uint32_t index, uint8_t brightness, uint8_t depth)>;
+
+    MatrixDriver() = delete;
+
+private:
+    static constexpr auto TAG = "MatrixDriver";
+
+    static constexpr uint8_t MATRIX_ROWS_PER_FRAME = Geometry::ROWS_PER_FRAME;
+    static constexpr uint16_t MATRIX_PIXELS_PER_ROW = Geometry::PIXELS_PER_ROW;
+    static constexpr uint8_t BCM_LSB_PLANES = 3;
+    static constexpr uint32_t MATRIX_PIXEL_CLOCK_HZ = 2500000;
+
+    static std::array<Frame, 2> frames_;
+    static uint8_t front_buffer_;
+    static std::array<bool, 2> rows_stale_;
+    static std::atomic<uint8_t> color_depth_;
+    static std::atomic<bool> bcm_enabled_;
+    static std::atomic<uint8_t> brightness_;
+    static std::atomic<uint32_t> rows_encoded_;
+    static std::atomic<uint32_t> rows_skipped_;
+    static std::atomic<uint32_t> frame_count_;
+    static std::mutex sink_mutex_;
+    static FrameSink sink_;
+
+    [[nodiscard]] static uint8_t backBuffer()
+    {
+        return front_buffer_ ^ 1;
+    }
+
+    [[nodiscard]] static constexpr size_t descPerRow(const uint8_t depth, const bool bcm)
+    {
+        size_t n = 0;
+        for (uint8_t k = 0; k < depth; k++)
+        {
+            n += bcm && k > BCM_LSB_PLANES ? 1 << (k - BCM_LSB_PLANES) : 1;
+        }
+        return n;
+    }
+
+public:
+    static esp_err_t start()
+    {
+        ESP_LOGI(TAG, "Starting simulated panel %ux%u...", WIDTH, HEIGHT);
+        for (auto& frame : frames_)
+        {
+            frame.fill(0);
+        }
+        front_buffer_ = 0;
+        rows_stale_ = {true, true};
+        frame_count_.store(0);
+        ESP_LOGI(TAG, "Running");
+        return ESP_OK;
+    }
+
+    static void stop()
+    {
+        ESP_LOGI(TAG, "Destroyed");
+    }
+
+    // Replace the frame sink, nullptr drops frames
+    static void setFrameSink(FrameSink sink)
+    {
+        std::lock_guard lock(sink_mutex_);
+        sink_ = std::move(sink);
+    }
+
+    static void loadFromBuffer(const std::array<uint32_t, SIZE>& buffer)
+    {
+        loadFromBuffer(buffer.data());
+    }
+
+    static void loadFromBuffer(const volatile uint32_t* buffer)
+    {
+        if (writeBackBuffer(buffer))
+        {
+            flipBuffers();
+        }
+    }
+
+    // Flips complete synchronously on the host
+    static bool waitForFlip(const TickType_t = 0)
+    {
+        return true;
+    }
+
+    static void flipBuffers()
+    {
+        front_buffer_ = backBuffer();
+        const uint32_t index = frame_count_.fetch_add(1);
+
+        std::lock_guard lock(sink_mutex_);
+        if (sink_)
+        {
+            sink_(frames_[front_buffer_], index, brightness_.load(), color_depth_.load());
+        }
+    }
+
+    static bool writeBackBuffer(const volatile uint32_t* buffer)
+    {
+        const uint8_t back = backBuffer();
+        Frame& frame = frames_[back];
+        uint32_t encoded = 0;
+
+        for (uint16_t r = 0; r < MATRIX_ROWS_PER_FRAME; r++)
+        {
+            bool changed = rows_stale_[back];
+            for (uint16_t c = 0; c < MATRIX_PIXELS_PER_ROW; c++)
+            {
+                const auto& pair = Geometry::MAP[r * MATRIX_PIXELS_PER_ROW + c];
+                changed |= frame[pair.top] != buffer[pair.top] || frame[pair.bot] != buffer[pair.bot];
+                frame[pair.top] = buffer[pair.top];
+                frame[pair.bot] = buffer[pair.bot];
+            }
+            encoded += changed;
+        }
+
+        rows_stale_[back] = false;
+        rows_encoded_.fetch_add(encoded);
+        rows_skipped_.fetch_add(MATRIX_ROWS_PER_FRAME - encoded);
+        return true;
+    }
+
+    static uint32_t getRowsEncoded()
+    {
+        return rows_encoded_.load();
+    }
+
+    static uint32_t getRowsSkipped()
+    {
+        return rows_skipped_.load();
+    }
+
+    // Frames flipped since start
+    static uint32_t getFrameCount()
+    {
+        return frame_count_.load();
+    }
+
+    static void setBrightness(const uint8_t brightness)
+    {
+        brightness_.store(brightness);
+    }
+
+    static uint8_t getBrightness()
+    {
+        return brightness_.load();
+    }
+
+    static esp_err_t setColorDepth(const uint8_t depth, const bool bcm = false)
+    {
+        if (depth < MIN_COLOR_DEPTH || depth > MAX_COLOR_DEPTH)
+        {
+            ESP_LOGE(TAG, "Color depth %d out of range [%d, %d]", depth, MIN_COLOR_DEPTH, MAX_COLOR_DEPTH);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        color_depth_.store(depth);
+        bcm_enabled_.store(bcm);
+        return ESP_OK;
+    }
+
+    static uint8_t getColorDepth()
+    {
+        return color_depth_.load();
+    }
+
+    // What the firmware would achieve with the current depth, the simulation itself has no scan-out
+    static uint32_t getRefreshRateHz()
+    {
+        const size_t words = MATRIX_ROWS_PER_FRAME * descPerRow(color_depth_.load(), bcm_enabled_.load()) *
+            MATRIX_PIXELS_PER_ROW;
+        return MATRIX_PIXEL_CLOCK_HZ / words;
+    }
+};
+
+std::array<MatrixDriver::Frame, 2> MatrixDriver::frames_;
+uint8_t MatrixDriver::front_buffer_ = 0;
+std::array<bool, 2> MatrixDriver::rows_stale_{true, true};
+std::atomic<uint8_t> MatrixDriver::color_depth_{MatrixDriver::MAX_COLOR_DEPTH};
+std::atomic<bool> MatrixDriver::bcm_enabled_{false};
+std::atomic<uint8_t> MatrixDriver::brightness_{255};
+std::atomic<uint32_t> MatrixDriver::rows_encoded_{0};
+std::atomic<uint32_t> MatrixDriver::rows_skipped_{0};
+std::atomic<uint32_t> MatrixDriver::frame_count_{0};
+std::mutex MatrixDriver::sink_mutex_;
+MatrixDriver::FrameSink MatrixDriver::sink_;
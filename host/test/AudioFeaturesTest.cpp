@@ -0,0 +1,138 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "util/AudioFeatures.hpp"
+#include "util/Filterbank.hpp"
+#include "util/SampleRing.hpp"
+#include "util/Spectrum.hpp"
+
+// Runs synthetic drum loops through the microphone chain (hops into a window, real FFT, log bands) and checks that
+// the feature tracker finds the onsets, the tempo and a beat phase that lines up with the kicks. Runs at hop sizes
+// across the range CONFIG_TOTEM_MIC_OVERLAP_PERCENT allows, from 512 new samples without overlap to 66 at 87%.
+
+static constexpr size_t N = 512;
+static constexpr size_t BINS = N / 2;
+static constexpr size_t BANDS = 64;
+static constexpr uint32_t SAMPLE_RATE = 22050;
+
+static constexpr double SECONDS = 20.0;
+static constexpr double SETTLE_SECONDS = 8.0; // Tempo history fills and the phase locks within this
+static constexpr double TEMPO_TOLERANCE = 0.03;
+static constexpr double PHASE_TOLERANCE = 0.15; // Of a beat, a hop is about 0.02 at 120 BPM
+
+// Kick on every beat, optionally a hi-hat on the off-beats, over a quiet noise bed
+static std::vector<int32_t> drumLoop(const double bpm, const double offset_s, const double gain, const bool hats,
+                                     const uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    const double beat_s = 60.0 / bpm;
+    std::vector<int32_t> samples(static_cast<size_t>(SECONDS * SAMPLE_RATE));
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const double t = static_cast<double>(i) / SAMPLE_RATE;
+        const double since_beat = std::fmod(t - offset_s + 100 * beat_s, beat_s);
+        const double since_offbeat = std::fmod(since_beat + beat_s / 2, beat_s);
+
+        const double kick = std::exp(-since_beat / 0.08) * std::sin(2 * M_PI * (60.0 + 90.0 * std::exp(-since_beat /
+            0.02)) * since_beat);
+        const double hat = hats * 0.3 * std::exp(-since_offbeat / 0.015) * noise(gen);
+        const double v = gain * (0.7 * kick + hat + 0.01 * noise(gen));
+
+        samples[i] = static_cast<int32_t>(std::clamp(std::lround(v * 32767.0), -32768L, 32767L)) << 16;
+    }
+    return samples;
+}
+
+struct Outcome
+{
+    double tempo_bpm;
+    double phase_error; // Mean distance of the phase from 0 at the kicks after settling, in beats
+    uint32_t onsets;
+};
+
+static Outcome run(const std::vector<int32_t>& samples, const size_t hop, const double bpm, const double offset_s)
+{
+    static const util::Filterbank<BINS, BANDS> filterbank{util::BandScale::LOG, SAMPLE_RATE, 40.0f, 10000.0f};
+
+    util::SampleRing<int32_t, N> window;
+    util::FloatSpectrum<N> spectrum;
+    util::AudioFeatureTracker<BANDS> tracker{static_cast<float>(SAMPLE_RATE) / hop};
+
+    std::array<int32_t, N> buffer{};
+    std::array<float, BINS> bins{};
+    std::array<float, BANDS> bands{};
+    util::AudioFeatures<BANDS> features{};
+
+    const double beat_s = 60.0 / bpm;
+    double phase_error = 0;
+    size_t phase_checks = 0;
+
+    for (size_t start = 0; start + hop <= samples.size(); start += hop)
+    {
+        window.push(std::span(samples).subspan(start, hop));
+        window.copy_to(buffer);
+        spectrum.compute(buffer, bins);
+        filterbank.apply(bins, bands);
+        tracker.update(bands, features);
+
+        // At the hop holding a kick the phase should be close to 0, the tracker sees the hop's newest sample
+        const double t = static_cast<double>(start + hop) / SAMPLE_RATE;
+        const double since_beat = std::fmod(t - offset_s + 100 * beat_s, beat_s);
+        if (t > SETTLE_SECONDS && since_beat < static_cast<double>(hop) / SAMPLE_RATE)
+        {
+            const double phase = features.beat_phase - since_beat / beat_s;
+            phase_error += std::abs(phase - std::round(phase));
+            phase_checks++;
+        }
+    }
+
+    return {features.tempo_bpm, phase_checks > 0 ? phase_error / phase_checks : 1.0, features.onsets};
+}
+
+int main()
+{
+    struct Case
+    {
+        double bpm;
+        double offset_s;
+        double gain;
+        bool hats;
+    };
+
+    int failures = 0;
+    for (const int overlap_percent : {0, 25, 50, 75, 87})
+    {
+        const size_t hop = N * (100 - overlap_percent) / 100;
+
+        // Slow loops with off-beat hats are ambiguous by an octave, the tracker leans towards the faster reading
+        for (const auto& [bpm, offset_s, gain, hats] : {
+                 Case{120.0, 0.0, 0.5, true}, Case{96.0, 0.21, 0.5, true}, Case{128.0, 0.37, 0.05, true},
+                 Case{140.0, 0.1, 0.8, true}, Case{75.0, 0.5, 0.3, false},
+             })
+        {
+            const Outcome outcome = run(drumLoop(bpm, offset_s, gain, hats, 7), hop, bpm, offset_s);
+
+            const double beats = SECONDS * bpm / 60.0;
+            const bool tempo_ok = std::abs(outcome.tempo_bpm - bpm) <= TEMPO_TOLERANCE * bpm;
+            const bool phase_ok = outcome.phase_error <= PHASE_TOLERANCE;
+            // Every kick and hi-hat should register, give or take a few at the start and end. Without overlap a hit
+            // that falls across two windows is split between their hops, and a fast loop loses a few of those.
+            const double hits = hats ? 2 * beats : beats;
+            const double missed_share = hop == N ? 0.15 : 0.05;
+            const bool onsets_ok = std::abs(static_cast<double>(outcome.onsets) - hits) <= missed_share * hits + 2;
+
+            std::printf("%s hop %3zu, %.0f BPM at %.0f%%: tempo %.1f, phase error %.3f beats, %u onsets for %.0f "
+                        "hits\n", tempo_ok && phase_ok && onsets_ok ? "ok  " : "FAIL", hop, bpm, gain * 100,
+                        outcome.tempo_bpm, outcome.phase_error, outcome.onsets, hits);
+            failures += !(tempo_ok && phase_ok && onsets_ok);
+        }
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,159 @@
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.hpp"
+#include "util/Blend.hpp"
+
+// Bounds the 8.8 fixed-point blend against the float blend Playlist used before it, per channel, over random frames
+// and weights for 1 to 8 children, and checks the cases that must be exact.
+
+static constexpr size_t PIXELS = 4096;
+// Steps of 1/255 per channel, each 8.8 weight is off by up to half of 1/256 so the bound grows with the children
+static constexpr int maxError(const size_t children)
+{
+    return children <= 4 ? 1 : 2;
+}
+static constexpr int TRIALS = 200;
+
+using Frame = std::vector<uint32_t>;
+
+// The float reference, as Playlist::render blended before
+static Frame floatBlend(const std::vector<Frame>& sources, const std::vector<float>& weights)
+{
+    float total = 0.0f;
+    for (const float w : weights) total += std::max(w, 0.0f);
+
+    Frame out(PIXELS);
+    for (size_t i = 0; i < PIXELS; i++)
+    {
+        float r_sum = 0.0f, g_sum = 0.0f, b_sum = 0.0f;
+        for (size_t j = 0; j < sources.size(); j++)
+        {
+            if (weights[j] <= 0.0f) continue;
+            const uint32_t color = sources[j][i];
+            const float norm = weights[j] / total;
+            r_sum += static_cast<float>((color >> 16) & 0xFF) * norm;
+            g_sum += static_cast<float>((color >> 8) & 0xFF) * norm;
+            b_sum += static_cast<float>(color & 0xFF) * norm;
+        }
+        out[i] = static_cast<uint32_t>(r_sum + 0.5f) << 16 | static_cast<uint32_t>(g_sum + 0.5f) << 8 |
+            static_cast<uint32_t>(b_sum + 0.5f);
+    }
+    return out;
+}
+
+static Frame fixedBlend(const std::vector<Frame>& sources, const std::vector<float>& weights)
+{
+    std::vector<uint16_t> fixed(weights.size());
+    Frame out(PIXELS);
+    if (!util::blend::normalize(weights, fixed)) return out;
+
+    std::vector<const uint32_t*> active;
+    std::vector<uint16_t> active_weights;
+    for (size_t j = 0; j < sources.size(); j++)
+    {
+        if (fixed[j] == 0) continue;
+        active.push_back(sources[j].data());
+        active_weights.push_back(fixed[j]);
+    }
+    util::blend::mix(active, active_weights, out.data(), PIXELS);
+    return out;
+}
+
+static int maxChannelError(const Frame& a, const Frame& b)
+{
+    int worst = 0;
+    for (size_t i = 0; i < PIXELS; i++)
+    {
+        for (const int shift : {0, 8, 16})
+        {
+            worst = std::max(worst, std::abs(static_cast<int>((a[i] >> shift) & 0xFF) -
+                                 static_cast<int>((b[i] >> shift) & 0xFF)));
+        }
+    }
+    return worst;
+}
+
+int main()
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> pixel(0, 0xFFFFFF);
+    std::uniform_real_distribution<float> weight(0.0f, 1.0f);
+
+    const auto randomFrame = [&]
+    {
+        Frame f(PIXELS);
+        for (auto& p : f) p = pixel(gen);
+        return f;
+    };
+
+    // Random frames, random weights, some children faded out entirely
+    for (size_t children = 1; children <= 8; children++)
+    {
+        int worst = 0;
+        for (int trial = 0; trial < TRIALS / 8; trial++)
+        {
+            std::vector<Frame> sources;
+            std::vector<float> weights;
+            for (size_t j = 0; j < children; j++)
+            {
+                sources.push_back(randomFrame());
+                weights.push_back(trial % 4 == 0 && j % 2 == 1 ? 0.0f : weight(gen));
+            }
+            worst = std::max(worst, maxChannelError(floatBlend(sources, weights), fixedBlend(sources, weights)));
+        }
+        std::printf("%zu children: worst channel error %d\n", children, worst);
+        test::check(std::to_string(children) + " children", worst <= maxError(children));
+    }
+
+    // A two-child crossfade at every step of its ramp
+    {
+        const std::vector<Frame> sources = {randomFrame(), randomFrame()};
+        int worst = 0;
+        for (int step = 0; step <= 1000; step++)
+        {
+            const float t = static_cast<float>(step) / 1000.0f;
+            worst = std::max(worst, maxChannelError(floatBlend(sources, {1.0f - t, t}),
+                                                    fixedBlend(sources, {1.0f - t, t})));
+        }
+        std::printf("crossfade: worst channel error %d\n", worst);
+        test::check("crossfade", worst <= maxError(2));
+    }
+
+    // Exact cases: a lone child, full white and black, and identical children at any weights
+    {
+        const Frame a = randomFrame();
+        test::check("lone child", fixedBlend({a}, {0.3f}) == a);
+
+        // What Playlist blends when only one of several visible children got a buffer: scaled, not copied
+        Frame half(PIXELS), expected(PIXELS);
+        const uint32_t* source = a.data();
+        const uint16_t weight = util::blend::ONE / 2;
+        util::blend::mix(std::span(&source, 1), std::span(&weight, 1), half.data(), PIXELS);
+        for (size_t i = 0; i < PIXELS; i++)
+        {
+            for (const int shift : {0, 8, 16})
+            {
+                expected[i] |= (((a[i] >> shift & 0xFF) * weight + 128) >> 8) << shift;
+            }
+        }
+        test::check("lone child at partial weight", half == expected);
+        test::check("one child at full weight", fixedBlend({a, randomFrame()}, {1.0f, 0.0f}) == a);
+        test::check("identical children", fixedBlend({a, a, a}, {0.2f, 0.5f, 0.3f}) == a);
+        test::check("white", fixedBlend({Frame(PIXELS, 0xFFFFFF), Frame(PIXELS, 0xFFFFFF)}, {0.7f, 0.1f}) ==
+                    Frame(PIXELS, 0xFFFFFF));
+        test::check("no weight", fixedBlend({a}, {0.0f}) == Frame(PIXELS, 0));
+
+        std::vector<uint16_t> fixed(5);
+        util::blend::normalize(std::vector<float>{0.1f, 0.0f, 0.7f, 1e-6f, 0.2f}, fixed);
+        test::check("weights sum to ONE", fixed[0] + fixed[1] + fixed[2] + fixed[3] + fixed[4] == util::blend::ONE);
+        test::check("zero weight stays zero", fixed[1] == 0);
+    }
+
+    return test::result();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief Minimal harness shared by the host tests
+ *
+ * check() counts a failed expectation and names it on stderr, result() turns the count into main's exit code. Only
+ * the first MAX_REPORTED failures are printed, so a test that checks every element stays readable when it breaks.
+ */
+namespace test
+{
+    inline constexpr int MAX_REPORTED = 10;
+    inline int failures = 0;
+
+    // Returns ok, for callers that print more detail on failure
+    inline bool check(const std::string& name, const bool ok)
+    {
+        if (!ok && failures++ < MAX_REPORTED)
+        {
+            std::fprintf(stderr, "FAIL %s\n", name.c_str());
+        }
+        return ok;
+    }
+
+    inline int result()
+    {
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
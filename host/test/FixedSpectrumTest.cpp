@@ -0,0 +1,110 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "util/Spectrum.hpp"
+
+// Bounds the Q31 microphone spectrum against the float one over tones, noise and silence at levels from full scale
+// down to -80 dBFS. Samples are 16-bit values left-justified like the INMP441's, which is all the float path reads,
+// so both paths see exactly the same input.
+
+static constexpr size_t N = 512;
+static constexpr size_t BINS = 64;
+static constexpr uint32_t SAMPLE_RATE = 22050;
+
+// The magnitude approximation is within 1.3%, Q31 rounding adds a small absolute floor (a full-scale tone peaks
+// around 128 on this scale)
+static constexpr double RELATIVE_BOUND = 0.013;
+static constexpr double ABSOLUTE_BOUND = 1e-4;
+
+using Samples = std::array<int32_t, N>;
+
+static int32_t toSample(const double v)
+{
+    return static_cast<int32_t>(std::clamp(std::lround(v * 32767.0), -32768L, 32767L)) << 16;
+}
+
+static Samples tone(const double hz, const double dbfs, const double phase = 0.0)
+{
+    Samples s{};
+    const double amplitude = std::pow(10.0, dbfs / 20.0);
+    for (size_t i = 0; i < N; i++)
+    {
+        s[i] = toSample(amplitude * std::sin(2.0 * M_PI * hz * i / SAMPLE_RATE + phase));
+    }
+    return s;
+}
+
+static Samples noise(const double dbfs, const uint32_t seed)
+{
+    Samples s{};
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> dist(0.0, std::pow(10.0, dbfs / 20.0) / 3.0);
+    for (auto& v : s) v = toSample(dist(gen));
+    return s;
+}
+
+int main()
+{
+    util::FloatSpectrum<N> float_path;
+    util::FixedSpectrum<N> fixed_path;
+
+    struct Case
+    {
+        std::string name;
+        Samples samples;
+    };
+
+    std::vector<Case> cases;
+    cases.push_back({"silence", Samples{}});
+    for (const double db : {-1.0, -20.0, -40.0, -60.0, -80.0})
+    {
+        for (const double hz : {43.0, 440.0, 1000.0, 2700.0})
+        {
+            cases.push_back({"tone " + std::to_string(static_cast<int>(hz)) + " Hz " +
+                             std::to_string(static_cast<int>(db)) + " dBFS", tone(hz, db, hz / 1000.0)});
+        }
+        cases.push_back({"noise " + std::to_string(static_cast<int>(db)) + " dBFS", noise(db, 7)});
+    }
+    {
+        Samples chord{};
+        const Samples a = tone(110.0, -6.0), b = tone(660.0, -12.0), c = tone(1980.0, -18.0);
+        for (size_t i = 0; i < N; i++) chord[i] = ((a[i] >> 2) + (b[i] >> 2) + (c[i] >> 2)) & ~0xFFFF;
+        cases.push_back({"chord", chord});
+    }
+    cases.push_back({"full scale square", [] {
+        Samples s{};
+        for (size_t i = 0; i < N; i++) s[i] = (i / 25) % 2 ? INT32_MIN : 0x7FFF0000;
+        return s;
+    }()});
+
+    int failures = 0;
+    double worst = 0; // Largest error as a fraction of its bound
+
+    for (const auto& [name, samples] : cases)
+    {
+        std::array<float, BINS> want{};
+        std::array<float, BINS> got{};
+        float_path.compute(samples, want);
+        fixed_path.compute(samples, got);
+
+        for (size_t k = 0; k < BINS; k++)
+        {
+            const double error = std::abs(static_cast<double>(got[k]) - want[k]);
+            const double bound = RELATIVE_BOUND * want[k] + ABSOLUTE_BOUND;
+            if (error > bound)
+            {
+                std::fprintf(stderr, "FAIL %s bin %zu: fixed %g float %g error %g > %g\n",
+                             name.c_str(), k, got[k], want[k], error, bound);
+                failures++;
+            }
+            worst = std::max(worst, error / bound);
+        }
+    }
+
+    std::printf("%zu cases, %d bins out of bounds, worst error %.0f%% of its bound\n", cases.size(), failures,
+                worst * 100);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
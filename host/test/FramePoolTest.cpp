@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Check.hpp"
+#include "FramePool.hpp"
+
+// Leases the whole pool, checks that the buffers are distinct, that an exhausted pool refuses rather than blocks,
+// and that moved and destroyed leases hand their buffer back exactly once.
+
+int main()
+{
+    test::check("empty before init", !FramePool::acquire());
+    test::check("init", FramePool::init() == ESP_OK);
+
+    {
+        std::vector<FramePool::Lease> leases;
+        for (size_t i = 0; i < FramePool::CAPACITY; i++)
+        {
+            leases.push_back(FramePool::acquire());
+            test::check("lease " + std::to_string(i), static_cast<bool>(leases.back()));
+            std::ranges::fill(leases.back().pixels(), static_cast<uint32_t>(i));
+        }
+        for (size_t i = 0; i < leases.size(); i++)
+        {
+            test::check("buffer " + std::to_string(i) + " untouched by the others",
+                  std::ranges::all_of(leases[i].pixels(), [&](const uint32_t p) { return p == i; }));
+        }
+
+        const auto full = FramePool::getOccupancy();
+        test::check("all in use", full.in_use == FramePool::CAPACITY && full.peak == FramePool::CAPACITY);
+        test::check("refused when full", !FramePool::acquire());
+        test::check("refusal counted", FramePool::getOccupancy().exhausted == full.exhausted + 1);
+
+        // Moving keeps the buffer leased once, dropping the target returns it
+        FramePool::Lease moved = std::move(leases.front());
+        test::check("moved from is empty", !leases.front());
+        leases.erase(leases.begin());
+        test::check("move keeps the lease", FramePool::getOccupancy().in_use == FramePool::CAPACITY);
+        moved = FramePool::Lease();
+        test::check("reassigning releases", FramePool::getOccupancy().in_use == FramePool::CAPACITY - 1);
+        test::check("released buffer leased again", static_cast<bool>(FramePool::acquire()));
+    }
+
+    const auto after = FramePool::getOccupancy();
+    test::check("all returned", after.in_use == 0);
+    test::check("peak kept", after.peak == FramePool::CAPACITY);
+    std::printf("%u buffers, peak %u, %u refused\n", after.capacity, after.peak, after.exhausted);
+
+    return test::result();
+}
@@ -0,0 +1,165 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.hpp"
+#include "MatrixDriver.hpp"
+
+// Checks MatrixEncoder, the row encoding MatrixDriver runs on the firmware, against a plain per-plane encoder over
+// random frames, for every color depth with and without BCM and at random brightness. Also checks that the row
+// hashes skip exactly the row pairs whose pixels did not change.
+
+using Encoder = MatrixEncoder<MatrixGeometry>;
+using Geometry = MatrixGeometry;
+
+static constexpr size_t ROWS = Encoder::ROWS_PER_FRAME;
+static constexpr size_t COLS = Encoder::PIXELS_PER_ROW;
+static constexpr size_t DEPTH = Encoder::COLOR_DEPTH;
+static constexpr int TRIALS = 20;
+
+// Bits wired to pins, the address of row -1 sets bits above them
+static constexpr uint16_t PIN_MASK = (1 << 13) - 1;
+// Written to planes that are not active, which must be left alone
+static constexpr uint16_t UNTOUCHED = 0xDEAD;
+
+using Frame = std::vector<uint32_t>;
+using Planes = std::vector<uint16_t>; // ROWS * DEPTH row buffers of COLS words
+
+namespace reference
+{
+    // Bit-plane d of the output code of one 8-bit channel
+    static uint16_t planeBit(const uint32_t channel, const size_t d)
+    {
+        return Encoder::lumTbl[Encoder::gammaTbl[channel & 0xFF]] >> (d + DEPTH) & 1;
+    }
+
+    // One plane at a time, one word at a time, straight from the pin layout
+    static void encode(const Frame& frame, const size_t depth, const Encoder::CtrlBits& ctrl, Planes& out)
+    {
+        for (size_t r = 0; r < ROWS; r++)
+        {
+            for (size_t d = DEPTH - depth; d < DEPTH; d++)
+            {
+                // The least significant active plane is shifted in while the previous row is still lit
+                const int address = d == DEPTH - depth ? static_cast<int>(r) - 1 : static_cast<int>(r);
+                for (size_t c = 0; c < COLS; c++)
+                {
+                    const auto& pair = Geometry::MAP[r * COLS + c];
+                    const uint32_t top = frame[pair.top];
+                    const uint32_t bot = frame[pair.bot];
+
+                    uint16_t word = planeBit(top >> 16, d) << 0 | planeBit(top >> 8, d) << 1 | planeBit(top, d) << 2 |
+                        planeBit(bot >> 16, d) << 3 | planeBit(bot >> 8, d) << 4 | planeBit(bot, d) << 5;
+                    word |= (address << 8) & Encoder::BITMASK_ABCDE;
+                    word |= ctrl[d][c];
+
+                    // Each pair of 16-bit words goes out high half first
+                    out[(r * DEPTH + d) * COLS + (c ^ 1)] = word;
+                }
+            }
+        }
+    }
+}
+
+// LAT on the last column, OE outside each plane's window, as MatrixDriver::applyBrightness() sets them
+static Encoder::CtrlBits ctrlBits(const uint8_t depth, const bool bcm, const uint8_t brightness)
+{
+    Encoder::CtrlBits ctrl{};
+    for (auto& plane : ctrl) plane[COLS - 1] = Encoder::BIT_LAT;
+
+    for (uint8_t k = 0; k < depth; k++)
+    {
+        const auto [min, max] = Encoder::oeWindow(k, depth, bcm, brightness);
+        for (int c = 0; c < static_cast<int>(COLS); c++)
+        {
+            if (c < min || c >= max) ctrl[DEPTH - depth + k][c] |= Encoder::BIT_OE;
+        }
+    }
+    return ctrl;
+}
+
+struct RowSet
+{
+    Planes words = Planes(ROWS * DEPTH * COLS, UNTOUCHED);
+    Encoder::RowBuffers bufs{};
+    Encoder::RowHashes hashes{};
+
+    RowSet()
+    {
+        for (size_t i = 0; i < bufs.size(); i++) bufs[i] = &words[i * COLS];
+    }
+};
+
+// First differing word of the active planes, or -1
+static long firstMismatch(const Planes& a, const Planes& b, const size_t depth)
+{
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        const bool active = (i / COLS) % DEPTH >= DEPTH - depth;
+        if (active ? (a[i] & PIN_MASK) != (b[i] & PIN_MASK) : a[i] != b[i]) return static_cast<long>(i);
+    }
+    return -1;
+}
+
+int main()
+{
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint32_t> pixel(0, 0xFFFFFF);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+    std::uniform_int_distribution<size_t> index(0, Geometry::SIZE - 1);
+
+    for (uint8_t depth = MatrixDriver::MIN_COLOR_DEPTH; depth <= MatrixDriver::MAX_COLOR_DEPTH; depth++)
+    {
+        for (const bool bcm : {false, true})
+        {
+            const std::string mode = std::to_string(depth) + (bcm ? " bit BCM" : " bit");
+            RowSet set;
+            Planes expected(ROWS * DEPTH * COLS, UNTOUCHED);
+
+            for (int trial = 0; trial < TRIALS; trial++)
+            {
+                const auto ctrl = ctrlBits(depth, bcm, static_cast<uint8_t>(byte(gen)));
+                Frame frame(Geometry::SIZE);
+                for (auto& p : frame) p = pixel(gen);
+
+                // A stale set encodes every row
+                const uint32_t encoded = Encoder::encode(frame.data(), depth, ctrl, set.bufs, set.hashes, true);
+                reference::encode(frame, depth, ctrl, expected);
+                test::check(mode + " full frame rows", encoded == ROWS);
+                if (const long at = firstMismatch(set.words, expected, depth); at >= 0)
+                {
+                    std::fprintf(stderr, "%s trial %d: word %ld is 0x%04x, expected 0x%04x\n", mode.c_str(), trial,
+                                 at, set.words[at], expected[at]);
+                    test::check(mode + " full frame", false);
+                    break;
+                }
+
+                // The same frame again changes nothing
+                test::check(mode + " unchanged frame",
+                            Encoder::encode(frame.data(), depth, ctrl, set.bufs, set.hashes, false) == 0);
+
+                // A few pixels change, only their row pairs are written and the result matches a full encode
+                std::array<bool, ROWS> dirty{};
+                for (int i = 0; i < trial % 8 + 1; i++)
+                {
+                    const size_t at = index(gen);
+                    frame[at] ^= 1u << (byte(gen) % 24);
+                    dirty[at / Geometry::WIDTH % ROWS] = true;
+                }
+                size_t dirty_rows = 0;
+                for (const bool d : dirty) dirty_rows += d;
+
+                const uint32_t partial = Encoder::encode(frame.data(), depth, ctrl, set.bufs, set.hashes, false);
+                reference::encode(frame, depth, ctrl, expected);
+                test::check(mode + " changed rows", partial == dirty_rows);
+                test::check(mode + " partial frame", firstMismatch(set.words, expected, depth) < 0);
+            }
+            std::printf("%s: ok\n", mode.c_str());
+        }
+    }
+
+    return test::result();
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Check.hpp"
+#include "PanelGeometry.hpp"
+
+// Checks PanelGeometry::MAP against the plain coordinate formula of each layout: every virtual pixel is placed on
+// its panel, row and column by hand and must be found at that position of the map, once.
+
+template <uint16_t W, uint16_t H, uint8_t CHAIN, PanelLayout LAYOUT, uint8_t TILE_ROWS = 1>
+static void checkGeometry(const std::string& name)
+{
+    using G = PanelGeometry<W, H, CHAIN, LAYOUT, TILE_ROWS>;
+    constexpr uint16_t ROWS = H / 2;
+    constexpr uint16_t PANELS_PER_ROW = CHAIN / TILE_ROWS;
+
+    test::check(name + " size", G::WIDTH == W * PANELS_PER_ROW && G::HEIGHT == H * TILE_ROWS &&
+                G::ROWS_PER_FRAME == ROWS && G::PIXELS_PER_ROW == W * CHAIN);
+
+    std::vector<int> seen(G::SIZE, 0);
+    int wrong = 0;
+
+    for (uint16_t vy = 0; vy < G::HEIGHT; vy++)
+    {
+        for (uint16_t vx = 0; vx < G::WIDTH; vx++)
+        {
+            uint16_t tile_x = vx / W;
+            const uint16_t tile_y = vy / H;
+            uint16_t px = vx % W;
+            uint16_t py = vy % H;
+
+            // Odd serpentine rows run right to left with their panels upside down
+            if (LAYOUT == PanelLayout::SERPENTINE && tile_y % 2 == 1)
+            {
+                tile_x = PANELS_PER_ROW - 1 - tile_x;
+                px = W - 1 - px;
+                py = H - 1 - py;
+            }
+
+            const uint16_t slot = tile_y * PANELS_PER_ROW + tile_x;
+            const auto& pair = G::MAP[py % ROWS * G::PIXELS_PER_ROW + slot * W + px];
+            const uint16_t index = vy * G::WIDTH + vx;
+
+            wrong += (py < ROWS ? pair.top : pair.bot) != index;
+        }
+    }
+
+    for (const auto& pair : G::MAP)
+    {
+        seen[pair.top]++;
+        seen[pair.bot]++;
+    }
+
+    test::check(name + " formula", wrong == 0);
+    test::check(name + " every pixel once", std::ranges::all_of(seen, [](const int n) { return n == 1; }));
+    std::printf("%s: %d misplaced\n", name.c_str(), wrong);
+}
+
+int main()
+{
+    checkGeometry<64, 64, 1, PanelLayout::HORIZONTAL>("64x64");
+    checkGeometry<64, 64, 2, PanelLayout::HORIZONTAL>("2 x 64x64 horizontal");
+    checkGeometry<64, 64, 4, PanelLayout::HORIZONTAL>("4 x 64x64 horizontal");
+    checkGeometry<64, 32, 4, PanelLayout::HORIZONTAL>("4 x 64x32 horizontal");
+    checkGeometry<64, 32, 4, PanelLayout::TILED, 2>("2x2 64x32 tiled");
+    checkGeometry<32, 32, 6, PanelLayout::TILED, 3>("2x3 32x32 tiled");
+    checkGeometry<64, 32, 4, PanelLayout::SERPENTINE, 2>("2x2 64x32 serpentine");
+    checkGeometry<64, 64, 6, PanelLayout::SERPENTINE, 3>("2x3 64x64 serpentine");
+    checkGeometry<32, 32, 8, PanelLayout::SERPENTINE, 4>("2x4 32x32 serpentine");
+
+    return test::result();
+}
@@ -0,0 +1,156 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Check.hpp"
+#include "Playlist.hpp"
+
+// Plays playlists of patterns that allocate a known amount and checks which of them are built frame by frame: built
+// one prefetch lead before their cue, released once their fade-out has ended, counted at their allocated size, and
+// only prefetched while that fits under the memory ceiling. Visible cues are built regardless.
+
+static constexpr uint32_t FRAME_MS = 10;
+static constexpr uint32_t PREFETCH_MS = 1000;
+
+// Holds BYTES of heap, ID tells the cues apart
+template <int ID, size_t BYTES>
+class BallastPattern final : public PatternBase
+{
+    std::vector<uint8_t> ballast_ = std::vector<uint8_t>(BYTES);
+
+public:
+    static inline int live = 0;
+
+    BallastPattern() : PatternBase("Ballast")
+    {
+        live++;
+    }
+
+    ~BallastPattern() override
+    {
+        live--;
+    }
+
+    void render(const FrameContext&) override
+    {
+        fill_rgb(ID, 0, 0);
+    }
+
+    [[nodiscard]] size_t footprint_bytes() const override
+    {
+        return ballast_.capacity();
+    }
+};
+
+class TestPlaylist final : public Playlist
+{
+public:
+    explicit TestPlaylist(const uint32_t total_ms, const size_t ceiling_bytes) : Playlist("TestPlaylist")
+    {
+        set_total_time(total_ms);
+        set_prefetch_time(PREFETCH_MS);
+        set_memory_ceiling(ceiling_bytes);
+    }
+
+    using Playlist::add_pattern;
+};
+
+// Renders frames like Totem, calling after_frame(time_ms) after each
+template <typename AfterFrame>
+static void play(TestPlaylist& playlist, const uint32_t frames, AfterFrame&& after_frame)
+{
+    static std::array<uint32_t, MatrixDriver::SIZE> frame{};
+    FrameContext ctx{};
+    for (uint32_t i = 1; i <= frames; i++)
+    {
+        ctx.dt_us = FRAME_MS * 1000;
+        ctx.index++;
+        playlist.bind(frame);
+        playlist.clear();
+        playlist.render(ctx);
+        after_frame(i * FRAME_MS);
+    }
+}
+
+int main()
+{
+    test::check("frame pool", FramePool::init() == ESP_OK);
+
+    // Prefetch and release: two light cues, the first one also built ahead of the next loop
+    {
+        using A = BallastPattern<1, 1024>;
+        using B = BallastPattern<2, 1024>;
+        constexpr uint32_t TOTAL_MS = 20000;
+
+        TestPlaylist playlist(TOTAL_MS, 128 * 1024);
+        playlist.add_pattern<A>(0, 4000, 500);
+        playlist.add_pattern<B>(6000, 10000, 500);
+
+        int wrong_a = 0, wrong_b = 0, wrong_bytes = 0;
+        play(playlist, TOTAL_MS / FRAME_MS - 1, [&](const uint32_t t)
+        {
+            // Resident from the prefetch lead to the end of the cue inclusive
+            wrong_a += A::live != (t <= 4000 || t >= TOTAL_MS - PREFETCH_MS);
+            wrong_b += B::live != (t >= 6000 - PREFETCH_MS && t <= 10000);
+
+            const size_t expected = (A::live + B::live) * (1024 + sizeof(A));
+            wrong_bytes += playlist.get_resident_bytes() != expected;
+        });
+        std::printf("prefetch: %d, %d frames with the wrong patterns built, %d with the wrong byte count\n", wrong_a,
+                    wrong_b, wrong_bytes);
+        test::check("first cue built and released", wrong_a == 0);
+        test::check("second cue prefetched and released", wrong_b == 0);
+        test::check("resident bytes include what patterns allocate", wrong_bytes == 0);
+    }
+
+    // Ceiling: the second heavy cue would start building while the first is still visible. That only happens the
+    // first time round, before its allocation is known, afterwards it waits until the first is released.
+    {
+        using A = BallastPattern<3, 64 * 1024>;
+        using B = BallastPattern<4, 64 * 1024>;
+        constexpr uint32_t TOTAL_MS = 10000;
+
+        TestPlaylist playlist(TOTAL_MS, 100 * 1024);
+        playlist.add_pattern<A>(0, 5000);
+        playlist.add_pattern<B>(5500, 9000);
+
+        int first_loop_early = 0, second_loop_early = 0, missing = 0;
+        play(playlist, 2 * TOTAL_MS / FRAME_MS, [&](const uint32_t t)
+        {
+            const uint32_t loop_ms = t % TOTAL_MS;
+            if (loop_ms >= 4600 && loop_ms <= 5000)
+            {
+                (t < TOTAL_MS ? first_loop_early : second_loop_early) += B::live;
+            }
+            if (loop_ms >= 5500 && loop_ms <= 9000) missing += !B::live;
+            test::check("never over the ceiling while prefetching",
+                        t < TOTAL_MS || playlist.get_resident_bytes() <= 100 * 1024);
+        });
+        std::printf("ceiling: built early in %d frames of the first loop, %d of the second\n", first_loop_early,
+                    second_loop_early);
+        test::check("first loop prefetches by object size", first_loop_early > 0);
+        test::check("second loop waits for room", second_loop_early == 0);
+        test::check("visible cue built", missing == 0);
+    }
+
+    // Visible cues over the ceiling are built anyway
+    {
+        using A = BallastPattern<5, 64 * 1024>;
+        using B = BallastPattern<6, 64 * 1024>;
+
+        TestPlaylist playlist(10000, 100 * 1024);
+        playlist.add_pattern<A>(0, 3000, 500);
+        playlist.add_pattern<B>(2000, 5000, 500);
+
+        bool both = false;
+        play(playlist, 300, [&](const uint32_t t)
+        {
+            if (t == 2500) both = A::live && B::live && playlist.get_resident_bytes() > 100 * 1024;
+        });
+        test::check("overlapping visible cues both built", both);
+    }
+
+    return test::result();
+}
@@ -0,0 +1,118 @@
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "util/SeqLock.hpp"
+#include "util/TripleBuffer.hpp"
+
+// Hammers the lock-free publication primitives with a producer that writes every element of each value as its
+// sequence number. A reader that ever sees mixed elements got a torn copy, one that sees the sequence go backwards
+// got a stale slot. Built with ThreadSanitizer, which also reports any access the primitives leave unordered.
+
+static constexpr uint32_t PUBLISHES = 100000;
+static constexpr size_t SEQLOCK_READERS = 3;
+
+// Odd size so the value does not line up with a cache line or the seqlock's words
+using Value = std::array<uint32_t, 67>;
+
+static bool consistent(const Value& v, const uint32_t expected)
+{
+    for (const uint32_t element : v)
+    {
+        if (element != expected) return false;
+    }
+    return true;
+}
+
+static int testSeqLock()
+{
+    static util::SeqLock<Value> lock;
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint32_t> backwards{0};
+    std::atomic<uint64_t> reads{0};
+
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < SEQLOCK_READERS; r++)
+    {
+        readers.emplace_back([&]
+        {
+            uint32_t last = 0;
+            uint64_t count = 0;
+            Value v{};
+            while (!done.load(std::memory_order_acquire))
+            {
+                const uint32_t seq = lock.read(v);
+                if (!consistent(v, seq)) torn.fetch_add(1);
+                if (seq < last) backwards.fetch_add(1);
+                last = seq;
+                count++;
+            }
+            reads.fetch_add(count);
+        });
+    }
+
+    Value v{};
+    for (uint32_t n = 1; n <= PUBLISHES; n++)
+    {
+        v.fill(n);
+        lock.publish(v);
+        if (n % 64 == 0) std::this_thread::yield(); // Let readers in on a single core
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& t : readers) t.join();
+
+    Value last{};
+    const uint32_t seq = lock.read(last);
+    const bool ok = torn == 0 && backwards == 0 && seq == PUBLISHES && consistent(last, PUBLISHES);
+    std::printf("SeqLock: %u publishes, %zu readers, %llu reads, %u torn, %u backwards: %s\n", PUBLISHES,
+                SEQLOCK_READERS, static_cast<unsigned long long>(reads.load()), torn.load(), backwards.load(),
+                ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static int testTripleBuffer()
+{
+    static util::TripleBuffer<Value> buffer;
+    std::atomic<bool> done{false};
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+    uint64_t reads = 0;
+
+    std::thread consumer([&]
+    {
+        uint32_t last = 0;
+        while (!done.load(std::memory_order_acquire))
+        {
+            if (!buffer.consume()) continue;
+            const Value& v = buffer.read_slot();
+            if (!consistent(v, v[0])) torn++;
+            if (v[0] < last) backwards++;
+            last = v[0];
+            reads++;
+        }
+    });
+
+    for (uint32_t n = 1; n <= PUBLISHES; n++)
+    {
+        buffer.write_slot().fill(n);
+        buffer.publish();
+        if (n % 64 == 0) std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    const bool ok = torn == 0 && backwards == 0;
+    std::printf("TripleBuffer: %u publishes, %llu reads, %u torn, %u backwards: %s\n", PUBLISHES,
+                static_cast<unsigned long long>(reads), torn, backwards, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int main()
+{
+    const int failures = testSeqLock() + testTripleBuffer();
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.hpp"
+#include "util/Timeline.hpp"
+
+// Follows random timelines forward, across loop boundaries and through random seeks, and compares the active set to
+// a scan of every cue. Some cues have two spans, some of them overlapping.
+
+struct Span
+{
+    uint32_t id;
+    uint32_t begin_ms;
+    uint32_t end_ms;
+};
+
+static std::vector<uint32_t> scan(const std::vector<Span>& spans, const uint32_t time_ms)
+{
+    std::vector<uint32_t> active;
+    for (const auto& [id, begin_ms, end_ms] : spans)
+    {
+        if (begin_ms <= time_ms && time_ms < end_ms) active.push_back(id);
+    }
+    std::ranges::sort(active);
+    active.erase(std::ranges::unique(active).begin(), active.end());
+    return active;
+}
+
+// The timeline's active set must match a scan of every span
+static void checkActive(const std::string& name, const util::Timeline& timeline, const std::vector<Span>& spans,
+                        const uint32_t time_ms)
+{
+    const auto got = timeline.active();
+    const auto want = scan(spans, time_ms);
+    test::check(name + " at " + std::to_string(time_ms) + " ms: " + std::to_string(got.size()) + " active, want " +
+                std::to_string(want.size()), std::ranges::equal(got, want));
+}
+
+int main()
+{
+    std::mt19937 gen(11);
+
+    for (const size_t cues : {0, 1, 31, 32, 33, 1000})
+    {
+        // Cues up to a tenth of the loop long, every fourth one in two pieces like a playlist cue that wraps
+        const uint32_t length_ms = 60000;
+        std::uniform_int_distribution<uint32_t> start(0, length_ms - 1);
+        std::uniform_int_distribution<uint32_t> duration(1, length_ms / 10);
+
+        std::vector<Span> spans;
+        util::Timeline timeline;
+        for (uint32_t id = 0; id < cues; id++)
+        {
+            const uint32_t begin_ms = start(gen);
+            const uint32_t end_ms = std::min(begin_ms + duration(gen), length_ms);
+            spans.push_back({id, begin_ms, end_ms});
+            if (id % 4 == 0 && begin_ms > 100) spans.push_back({id, 0, begin_ms / 2});
+            if (id % 5 == 0) spans.push_back({id, begin_ms + (end_ms - begin_ms) / 2, end_ms + 10}); // Overlapping
+        }
+        std::ranges::shuffle(spans, gen);
+        for (const auto& [id, begin_ms, end_ms] : spans) timeline.add(id, begin_ms, end_ms);
+        timeline.compile();
+        checkActive("compile", timeline, spans, 0);
+
+        // Frames of uneven length over three loops
+        std::uniform_int_distribution<uint32_t> frame(0, 40);
+        uint32_t time_ms = 0;
+        for (uint32_t elapsed = 0; elapsed < 3 * length_ms; )
+        {
+            const uint32_t dt = frame(gen);
+            elapsed += dt;
+            time_ms = (time_ms + dt) % length_ms;
+            timeline.advance(time_ms);
+            checkActive(std::to_string(cues) + " cues advance", timeline, spans, time_ms);
+        }
+
+        for (int i = 0; i < 2000; i++)
+        {
+            time_ms = start(gen);
+            timeline.seek(time_ms);
+            checkActive(std::to_string(cues) + " cues seek", timeline, spans, time_ms);
+        }
+
+        // Exactly at span boundaries, where leaves and enters at the same time meet
+        for (const auto& [id, begin_ms, end_ms] : spans)
+        {
+            timeline.seek(end_ms);
+            checkActive(std::to_string(cues) + " cues at end", timeline, spans, end_ms);
+            timeline.seek(begin_ms);
+            checkActive(std::to_string(cues) + " cues at begin", timeline, spans, begin_ms);
+        }
+
+        std::printf("%zu cues: %s\n", cues, test::failures == 0 ? "ok" : "FAIL");
+    }
+
+    return test::result();
+}
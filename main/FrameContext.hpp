@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Microphone.hpp"
+
+// What every pattern rendering one frame shares, filled once per frame by Totem so that all of them see the same
+// timestamp and the same audio
+struct FrameContext
+{
+    int64_t time_us; // esp_timer time the frame is rendered at
+    uint32_t dt_us; // Since the previous frame of the same pattern, 0 on its first
+    uint32_t index; // Frames rendered since start
+    uint32_t audio_update; // Microphone update count of audio, unchanged until a new hop is analysed
+    Microphone::Analysis audio;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <span>
+#include <utility>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "MatrixDriver.hpp"
+
+/**
+ * @brief Fixed set of frame buffers that patterns render into while they are being composited
+ *
+ * The buffers are allocated once, from internal RAM or PSRAM as configured, and leased for the part of a frame they
+ * are needed: a Playlist leases one per child it blends and hands them back after the blend. Patterns own no pixels,
+ * so only as many buffers exist as patterns are composited at once. Leasing is a compare-and-swap on a bitmask, so
+ * the occupancy can be read from any thread.
+ */
+class FramePool final
+{
+    static constexpr auto TAG = "FramePool";
+
+public:
+    static constexpr size_t CAPACITY = CONFIG_TOTEM_FRAME_POOL_BUFFERS;
+    static constexpr size_t BUFFER_BYTES = MatrixDriver::SIZE * sizeof(uint32_t);
+
+    using Pixels = std::span<uint32_t, MatrixDriver::SIZE>;
+
+private:
+    static_assert(CAPACITY > 0 && CAPACITY <= 32, "One bit per buffer in a 32-bit mask");
+    static constexpr uint32_t ALL = CAPACITY == 32 ? ~0u : (1u << CAPACITY) - 1;
+
+    static uint32_t* storage_;
+    static std::atomic<uint32_t> leased_; // One bit per buffer
+    static std::atomic<uint32_t> peak_;
+    static std::atomic<uint32_t> exhausted_;
+
+    static void release(const uint32_t index)
+    {
+        leased_.fetch_and(~(1u << index), std::memory_order_release);
+    }
+
+public:
+    FramePool() = delete;
+
+    // One buffer until destroyed, empty if the pool had none left
+    class Lease final
+    {
+        friend class FramePool;
+
+        static constexpr uint32_t NONE = ~0u;
+        uint32_t index_ = NONE;
+
+        explicit Lease(const uint32_t index) : index_(index)
+        {
+        }
+
+    public:
+        Lease() = default;
+
+        Lease(Lease&& other) noexcept : index_(std::exchange(other.index_, NONE))
+        {
+        }
+
+        Lease& operator=(Lease&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (index_ != NONE) release(index_);
+                index_ = std::exchange(other.index_, NONE);
+            }
+            return *this;
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease()
+        {
+            if (index_ != NONE) release(index_);
+        }
+
+        explicit operator bool() const
+        {
+            return index_ != NONE;
+        }
+
+        [[nodiscard]] Pixels pixels() const
+        {
+            return Pixels(storage_ + index_ * MatrixDriver::SIZE, MatrixDriver::SIZE);
+        }
+    };
+
+    static esp_err_t init()
+    {
+        if (storage_ != nullptr) return ESP_OK;
+
+#if CONFIG_TOTEM_FRAME_POOL_PSRAM
+        constexpr uint32_t caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+        constexpr auto where = "PSRAM";
+#else
+        constexpr uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        constexpr auto where = "internal RAM";
+#endif
+        storage_ = static_cast<uint32_t*>(heap_caps_calloc(CAPACITY, BUFFER_BYTES, caps));
+        if (storage_ == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %zu frame buffers in %s", CAPACITY, where);
+            return ESP_ERR_NO_MEM;
+        }
+
+        ESP_LOGI(TAG, "%zu frame buffers, %zu bytes in %s", CAPACITY, CAPACITY * BUFFER_BYTES, where);
+        return ESP_OK;
+    }
+
+    // Never blocks, a caller that gets an empty lease has to do without the buffer this frame
+    [[nodiscard]] static Lease acquire()
+    {
+        uint32_t leased = leased_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            const uint32_t free = ~leased & ALL;
+            if (storage_ == nullptr || free == 0)
+            {
+                exhausted_.fetch_add(1, std::memory_order_relaxed);
+                return {};
+            }
+
+            const uint32_t bit = free & -free;
+            if (leased_.compare_exchange_weak(leased, leased | bit, std::memory_order_acquire,
+                                              std::memory_order_relaxed))
+            {
+                const auto in_use = static_cast<uint32_t>(std::popcount(leased | bit));
+                uint32_t peak = peak_.load(std::memory_order_relaxed);
+                while (in_use > peak && !peak_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed))
+                {
+                }
+                return Lease(std::countr_zero(bit));
+            }
+        }
+    }
+
+    struct Occupancy
+    {
+        uint32_t capacity;
+        uint32_t in_use;
+        uint32_t peak; // Most buffers leased at once since boot
+        uint32_t exhausted; // Leases refused because every buffer was taken
+    };
+
+    [[nodiscard]] static Occupancy getOccupancy()
+    {
+        return {
+            CAPACITY, static_cast<uint32_t>(std::popcount(leased_.load(std::memory_order_relaxed))),
+            peak_.load(std::memory_order_relaxed), exhausted_.load(std::memory_order_relaxed)
+        };
+    }
+};
+
+uint32_t* FramePool::storage_ = nullptr;
+std::atomic<uint32_t> FramePool::leased_{0};
+std::atomic<uint32_t> FramePool::peak_{0};
+std::atomic<uint32_t> FramePool::exhausted_{0};
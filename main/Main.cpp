@@ -12,6 +12,9 @@
 #include "RestServer.hpp"
 
 #include "patterns/AudioSpectrumPattern.hpp"
+#include "patterns/LoadingPattern.hpp"
+#include "patterns/SinglePixelPattern.hpp"
+#include "patterns/SolidColorPattern.hpp"
 #include "playlists/DefaultPlaylist.hpp"
 #include "patterns/WifiConnectingPattern.hpp"
 
@@ -30,6 +33,9 @@ extern "C" void app_main(void)
     PatternRegistry::add_pattern<FirePattern>();
     PatternRegistry::add_pattern<WifiConnectingPattern>();
     PatternRegistry::add_pattern<DefaultPlaylist>();
+    PatternRegistry::add_pattern<LoadingPattern>();
+    PatternRegistry::add_pattern<SolidColorPattern>();
+    PatternRegistry::add_pattern<SinglePixelPattern>();
 
     // PatternRegistry::add_pattern<Playlist>();
 
@@ -41,12 +47,6 @@ extern "C" void app_main(void)
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     // In app_main function or early initialization code
 
-    // You can uncomment these once DefaultPlaylist is working properly
-    // PatternRegistry::add_pattern<FirePattern>();
-    // PatternRegistry::add_pattern<LoadingPattern>();
-    // PatternRegistry::add_pattern<SolidColorPattern>();
-    // PatternRegistry::add_pattern<SinglePixelPattern>();
-
     // ESP_ERROR_CHECK(mdns_init());
     // ESP_ERROR_CHECK(mdns_hostname_set(MDNS_HOST_NAME));
     // ESP_ERROR_CHECK(mdns_instance_name_set(MDNS_INSTANCE));
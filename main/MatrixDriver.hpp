@@ -1,13 +1,32 @@
 #pragma once
 
+#include "sdkconfig.h"
+#include "MatrixEncoder.hpp"
+#include "PanelGeometry.hpp"
+
+// Physical panel arrangement, e.g. PanelGeometry<64, 32, 4, PanelLayout::SERPENTINE, 2> for a 2x2 grid of
+// 1/16 scan panels
+using MatrixGeometry = PanelGeometry<64, 64>;
+
+#if CONFIG_IDF_TARGET_LINUX
+
+// Host builds swap the I2S/DMA driver for one with the same interface that hands frames to a sink
+#include "SimMatrixDriver.hpp"
+
+#else
+
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <utility>
 
+#include "esp_intr_alloc.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
 #include "esp_private/periph_ctrl.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "hal/i2s_hal.h"
 #include "hal/i2s_ll.h"
 #include "rom/lldesc.h"
@@ -16,19 +35,43 @@
 class MatrixDriver final
 {
 public:
-    static constexpr uint8_t WIDTH = 64;
-    static constexpr uint8_t HEIGHT = 64;
-    static constexpr uint16_t SIZE = WIDTH * HEIGHT;
-    static constexpr uint16_t BUF_SIZE = SIZE * sizeof(uint32_t);
+    using Geometry = MatrixGeometry;
+
+    static constexpr uint16_t WIDTH = Geometry::WIDTH;
+    static constexpr uint16_t HEIGHT = Geometry::HEIGHT;
+    static constexpr uint16_t SIZE = Geometry::SIZE;
+    static constexpr uint32_t BUF_SIZE = SIZE * sizeof(uint32_t);
+
+    static constexpr uint8_t MIN_COLOR_DEPTH = 4;
+    static constexpr uint8_t MAX_COLOR_DEPTH = 8;
 
     MatrixDriver() = delete;
 
 private:
     static constexpr auto TAG = "MatrixDriver";
 
-    static constexpr uint8_t MATRIX_ROWS_PER_FRAME = HEIGHT / 2;
-    static constexpr uint8_t MATRIX_PIXELS_PER_ROW = WIDTH;
-    static constexpr uint8_t MATRIX_COLOR_DEPTH = 8;
+    using Encoder = MatrixEncoder<Geometry>;
+
+    static constexpr uint8_t MATRIX_ROWS_PER_FRAME = Geometry::ROWS_PER_FRAME;
+    static constexpr uint16_t MATRIX_PIXELS_PER_ROW = Geometry::PIXELS_PER_ROW;
+    static_assert(MATRIX_PIXELS_PER_ROW * sizeof(uint16_t) < 4096, "Row exceeds the 12-bit DMA descriptor length");
+    static constexpr uint8_t MATRIX_COLOR_DEPTH = Encoder::COLOR_DEPTH;
+    static_assert(MATRIX_COLOR_DEPTH == MAX_COLOR_DEPTH, "Row buffers exist for every plane of the deepest mode");
+
+    // Binary code modulation: planes below BCM_LSB_PLANES are shortened through their OE window, planes above
+    // it repeat their row buffer through extra descriptors, so each plane is lit twice as long as the one below
+    static constexpr uint8_t BCM_LSB_PLANES = Encoder::BCM_LSB_PLANES;
+    static constexpr size_t MATRIX_MAX_DESC_PER_ROW = BCM_LSB_PLANES + (1 << (MATRIX_COLOR_DEPTH - BCM_LSB_PLANES)) - 1;
+    static constexpr size_t MATRIX_DESC_COUNT = MATRIX_ROWS_PER_FRAME * MATRIX_MAX_DESC_PER_ROW;
+
+    static constexpr uint32_t I2S_BASE_CLOCK_HZ = 80000000;
+    static constexpr uint32_t I2S_CLKM_DIV_NUM = 16;
+    static constexpr uint32_t I2S_BCK_DIV_NUM = 2;
+    static constexpr uint32_t MATRIX_PIXEL_CLOCK_HZ = I2S_BASE_CLOCK_HZ / I2S_CLKM_DIV_NUM / I2S_BCK_DIV_NUM;
+
+    // Front set is being scanned out by DMA, back set is free for encoding the next frame
+    static constexpr uint8_t DMA_BUFFER_COUNT = 2;
+    static constexpr TickType_t FLIP_TIMEOUT = pdMS_TO_TICKS(100);
 
     static constexpr uint32_t PIN_R1 = 27;
     static constexpr uint32_t PIN_G1 = 26;
@@ -51,73 +94,244 @@ private:
         PIN_C, PIN_D, PIN_E
     };
 
-    static constexpr uint16_t BIT_R1 = 1 << 0;
-    static constexpr uint16_t BIT_G1 = 1 << 1;
-    static constexpr uint16_t BIT_B1 = 1 << 2;
-    static constexpr uint16_t BIT_R2 = 1 << 3;
-    static constexpr uint16_t BIT_G2 = 1 << 4;
-    static constexpr uint16_t BIT_B2 = 1 << 5;
-    static constexpr uint16_t BIT_A = 1 << 8;
-    static constexpr uint16_t BIT_B = 1 << 9;
-    static constexpr uint16_t BIT_C = 1 << 10;
-    static constexpr uint16_t BIT_D = 1 << 11;
-    static constexpr uint16_t BIT_E = 1 << 12;
-    static constexpr uint16_t BIT_LAT = 1 << 6;
-    static constexpr uint16_t BIT_OE = 1 << 7;
-    static constexpr uint16_t BIT_CLK = 1 << 13;
-
-    static constexpr uint16_t BITMASK_RGB1 = BIT_R1 | BIT_G1 | BIT_B1;
-    static constexpr uint16_t BITMASK_RGB2 = BIT_R2 | BIT_G2 | BIT_B2;
-    static constexpr uint16_t BITMASK_RGB1_RBG2 = BITMASK_RGB1 | BITMASK_RGB2;
-    static constexpr uint16_t BITMASK_ABCDE = BIT_A | BIT_B | BIT_C | BIT_D | BIT_E;
-    static constexpr int BITS_ABCDE_OFFSET = 8;
-
-    static constexpr uint16_t DRAM_ATTR lumTbl[] = {
-        0, 27, 56, 84, 113, 141, 170, 198, 227, 255, 284, 312, 340, 369,
-        397, 426, 454, 483, 511, 540, 568, 597, 626, 657, 688, 720, 754, 788,
-        824, 860, 898, 936, 976, 1017, 1059, 1102, 1146, 1191, 1238, 1286, 1335, 1385,
-        1436, 1489, 1543, 1598, 1655, 1713, 1772, 1833, 1895, 1958, 2023, 2089, 2156, 2225,
-        2296, 2368, 2441, 2516, 2592, 2670, 2750, 2831, 2914, 2998, 3084, 3171, 3260, 3351,
-        3443, 3537, 3633, 3731, 3830, 3931, 4034, 4138, 4245, 4353, 4463, 4574, 4688, 4803,
-        4921, 5040, 5161, 5284, 5409, 5536, 5665, 5796, 5929, 6064, 6201, 6340, 6482, 6625,
-        6770, 6917, 7067, 7219, 7372, 7528, 7687, 7847, 8010, 8174, 8341, 8511, 8682, 8856,
-        9032, 9211, 9392, 9575, 9761, 9949, 10139, 10332, 10527, 10725, 10925, 11127, 11332, 11540,
-        11750, 11963, 12178, 12395, 12616, 12839, 13064, 13292, 13523, 13757, 13993, 14231, 14473, 14717,
-        14964, 15214, 15466, 15722, 15980, 16240, 16504, 16771, 17040, 17312, 17587, 17865, 18146, 18430,
-        18717, 19006, 19299, 19595, 19894, 20195, 20500, 20808, 21119, 21433, 21750, 22070, 22393, 22720,
-        23049, 23382, 23718, 24057, 24400, 24745, 25094, 25446, 25802, 26160, 26522, 26888, 27256, 27628,
-        28004, 28382, 28765, 29150, 29539, 29932, 30328, 30727, 31130, 31536, 31946, 32360, 32777, 33197,
-        33622, 34049, 34481, 34916, 35354, 35797, 36243, 36692, 37146, 37603, 38064, 38528, 38996, 39469,
-        39945, 40424, 40908, 41395, 41886, 42382, 42881, 43383, 43890, 44401, 44916, 45434, 45957, 46484,
-        47014, 47549, 48088, 48630, 49177, 49728, 50283, 50842, 51406, 51973, 52545, 53120, 53700, 54284,
-        54873, 55465, 56062, 56663, 57269, 57878, 58492, 59111, 59733, 60360, 60992, 61627, 62268, 62912,
-        63561, 64215, 64873, 65535
-    };
+    struct BufferConfig
+    {
+        uint8_t depth;
+        bool bcm;
 
-    static constexpr uint8_t DRAM_ATTR gammaTbl[] = {
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
-        1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
-        4, 4, 5, 5, 5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9,
-        9, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16,
-        16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22, 23, 23, 24, 24,
-        25, 26, 26, 27, 28, 28, 29, 30, 30, 31, 32, 32, 33, 34, 35, 35,
-        36, 37, 38, 38, 39, 40, 41, 42, 42, 43, 44, 45, 46, 47, 47, 48,
-        49, 50, 51, 52, 53, 54, 55, 56, 56, 57, 58, 59, 60, 61, 62, 63,
-        64, 65, 66, 67, 68, 69, 70, 71, 73, 74, 75, 76, 77, 78, 79, 80,
-        81, 82, 84, 85, 86, 87, 88, 89, 91, 92, 93, 94, 95, 97, 98, 99,
-        100, 102, 103, 104, 105, 107, 108, 109, 111, 112, 113, 115, 116, 117, 119, 120,
-        121, 123, 124, 126, 127, 128, 130, 131, 133, 134, 136, 137, 139, 140, 142, 143,
-        145, 146, 148, 149, 151, 152, 154, 155, 157, 158, 160, 162, 163, 165, 166, 168,
-        170, 171, 173, 175, 176, 178, 180, 181, 183, 185, 186, 188, 190, 192, 193, 195,
-        197, 199, 200, 202, 204, 206, 207, 209, 211, 213, 215, 217, 218, 220, 222, 224,
-        226, 228, 230, 232, 233, 235, 237, 239, 241, 243, 245, 247, 249, 251, 253, 255,
+        bool operator==(const BufferConfig&) const = default;
     };
 
-    static lldesc_t* dma_desc_;
+    static std::array<lldesc_t*, DMA_BUFFER_COUNT> dma_desc_;
+    static std::array<Encoder::RowBuffers, DMA_BUFFER_COUNT> row_buf_;
+    static std::array<size_t, DMA_BUFFER_COUNT> desc_count_;
+    static std::array<BufferConfig, DMA_BUFFER_COUNT> buffer_config_;
+    static std::atomic<uint8_t> color_depth_;
+    static std::atomic<bool> bcm_enabled_;
+    static std::atomic<uint8_t> brightness_;
+    static std::array<uint8_t, DMA_BUFFER_COUNT> applied_brightness_;
+    static std::atomic<uint8_t> front_buffer_;
+    static std::atomic<bool> flip_pending_;
+    static SemaphoreHandle_t flip_done_;
+    static intr_handle_t eof_intr_;
+
+    // Hash of the pixels last encoded into each row pair of each set, rows with an unchanged hash are skipped
+    // unless the set was reconfigured since
+    static std::array<Encoder::RowHashes, DMA_BUFFER_COUNT> row_hash_;
+    static std::array<bool, DMA_BUFFER_COUNT> rows_stale_;
+    static std::atomic<uint32_t> rows_encoded_;
+    static std::atomic<uint32_t> rows_skipped_;
+
+    // Non-color bits (LAT and OE) of every pixel per set and bit-plane, so rows can be written without reading
+    // DMA memory
+    static std::array<Encoder::CtrlBits, DMA_BUFFER_COUNT> ctrl_bits_;
+
+    [[nodiscard]] static volatile uint16_t* rowBufAt(const uint8_t buf_idx, const size_t row, const size_t plane)
+    {
+        return row_buf_[buf_idx][row * MATRIX_COLOR_DEPTH + plane];
+    }
+
+    // Descriptors spent on the k-th least significant active plane of a row
+    [[nodiscard]] static constexpr size_t planeRepeats(const uint8_t k, const bool bcm)
+    {
+        return bcm && k > BCM_LSB_PLANES ? 1 << (k - BCM_LSB_PLANES) : 1;
+    }
+
+    // Descriptors spent on one row at the given depth
+    [[nodiscard]] static constexpr size_t descPerRow(const uint8_t depth, const bool bcm)
+    {
+        size_t n = 0;
+        for (uint8_t k = 0; k < depth; k++)
+        {
+            n += planeRepeats(k, bcm);
+        }
+        return n;
+    }
+
+    [[nodiscard]] static uint8_t backBuffer()
+    {
+        return 1 - front_buffer_.load();
+    }
+
+    [[nodiscard]] static bool IRAM_ATTR ownsDescriptor(const uint8_t buf_idx, const uint32_t addr)
+    {
+        const auto first = reinterpret_cast<uint32_t>(&dma_desc_[buf_idx][0]);
+        const auto last = reinterpret_cast<uint32_t>(&dma_desc_[buf_idx][desc_count_[buf_idx] - 1]);
+        return addr >= first && addr <= last;
+    }
 
-    [[nodiscard]] static volatile uint16_t* dmaDescAt(const size_t idx)
+    // Fires at the end of every frame. A pending flip is only complete once the DMA is actually walking the
+    // back set, since a relink that lands after the last descriptor was fetched takes effect one frame later.
+    static void IRAM_ATTR onFrameEof(void*)
     {
-        return reinterpret_cast<volatile uint16_t*>(const_cast<uint8_t*>(dma_desc_[idx].buf));
+        i2s_dev_t* dev = &I2S0;
+        dev->int_clr.out_eof = 1;
+
+        if (!flip_pending_.load()) return;
+
+        const uint8_t back = backBuffer();
+        if (!ownsDescriptor(back, dev->out_link_dscr)) return;
+
+        front_buffer_.store(back);
+        flip_pending_.store(false);
+
+        BaseType_t task_woken = pdFALSE;
+        xSemaphoreGiveFromISR(flip_done_, &task_woken);
+        if (task_woken) portYIELD_FROM_ISR();
+    }
+
+    static esp_err_t allocDmaBuffer(const uint8_t buf_idx)
+    {
+        lldesc_t* desc = dma_desc_[buf_idx] = static_cast<lldesc_t*>(
+            heap_caps_malloc(sizeof(lldesc_t) * MATRIX_DESC_COUNT, MALLOC_CAP_DMA));
+
+        if (desc == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to allocate memory for DMA descriptors");
+            return ESP_ERR_NO_MEM;
+        }
+
+        for (size_t r = 0; r < MATRIX_ROWS_PER_FRAME; r++)
+        {
+            auto abcde = static_cast<uint16_t>(r);
+            abcde <<= Encoder::BITS_ABCDE_OFFSET;
+
+            for (size_t d = 0; d < MATRIX_COLOR_DEPTH; d++)
+            {
+                const auto row_buf = static_cast<volatile uint16_t*>(
+                    heap_caps_malloc(MATRIX_PIXELS_PER_ROW * sizeof(uint16_t), MALLOC_CAP_DMA));
+
+                if (row_buf == nullptr)
+                {
+                    ESP_LOGE(TAG, "Failed to allocate memory for row buffer");
+                    return ESP_ERR_NO_MEM;
+                }
+
+                for (size_t p = 0; p < MATRIX_PIXELS_PER_ROW; p++)
+                {
+                    if (d == 0)
+                    {
+                        // depth[0] (LSB) x_pixels must be "marked" with the previous's row address,
+                        // because it is used to display the previous row while we pump in LSB's for a new row
+                        row_buf[Encoder::xCoord(p)] = (static_cast<uint16_t>(r) - 1) << Encoder::BITS_ABCDE_OFFSET;
+                    }
+                    else
+                    {
+                        row_buf[Encoder::xCoord(p)] = abcde;
+                    }
+                }
+
+                row_buf[Encoder::xCoord(MATRIX_PIXELS_PER_ROW - 1)] |= Encoder::BIT_LAT;
+                row_buf_[buf_idx][r * MATRIX_COLOR_DEPTH + d] = row_buf;
+            }
+        }
+
+        for (auto& plane_ctrl : ctrl_bits_[buf_idx])
+        {
+            plane_ctrl.fill(0);
+            plane_ctrl[MATRIX_PIXELS_PER_ROW - 1] = Encoder::BIT_LAT;
+        }
+
+        buffer_config_[buf_idx] = {MATRIX_COLOR_DEPTH, false};
+        linkDmaBuffer(buf_idx);
+        rows_stale_[buf_idx] = true;
+        return ESP_OK;
+    }
+
+    // Build the descriptor chain of a set for its color depth and modulation. Only valid on a set the DMA is
+    // not walking. Each set loops onto itself until flipBuffers() links the front set into the back set.
+    static void linkDmaBuffer(const uint8_t buf_idx)
+    {
+        const BufferConfig& config = buffer_config_[buf_idx];
+        const uint8_t first_plane = MATRIX_COLOR_DEPTH - config.depth;
+        lldesc_t* desc = dma_desc_[buf_idx];
+        size_t n = 0;
+
+        for (size_t r = 0; r < MATRIX_ROWS_PER_FRAME; r++)
+        {
+            for (uint8_t k = 0; k < config.depth; k++)
+            {
+                const volatile uint16_t* row_buf = rowBufAt(buf_idx, r, first_plane + k);
+
+                for (size_t i = 0; i < planeRepeats(k, config.bcm); i++)
+                {
+                    lldesc_t* row_desc = &desc[n++];
+                    row_desc->size = MATRIX_PIXELS_PER_ROW * sizeof(uint16_t);
+                    row_desc->length = MATRIX_PIXELS_PER_ROW * sizeof(uint16_t);
+                    row_desc->buf = reinterpret_cast<const volatile uint8_t*>(row_buf);
+                    row_desc->eof = 0;
+                    row_desc->sosf = 0;
+                    row_desc->owner = 1;
+                    row_desc->qe.stqe_next = &desc[n];
+                    row_desc->offset = 0;
+                }
+            }
+        }
+
+        desc[n - 1].eof = 1;
+        desc[n - 1].qe.stqe_next = &desc[0];
+        desc_count_[buf_idx] = n;
+    }
+
+    // Set the OE bit of one column of a plane in every row of a set
+    static void setOutputEnable(const uint8_t buf_idx, const uint8_t plane, const int x_coord, const bool enabled)
+    {
+        uint16_t& ctrl = ctrl_bits_[buf_idx][plane][x_coord];
+        ctrl = enabled ? ctrl & ~Encoder::BIT_OE : ctrl | Encoder::BIT_OE;
+
+        for (size_t r = 0; r < MATRIX_ROWS_PER_FRAME; r++)
+        {
+            const auto row = rowBufAt(buf_idx, r, plane);
+            const int xc = Encoder::xCoord(x_coord);
+            row[xc] = (row[xc] & ~Encoder::BIT_OE) | (ctrl & Encoder::BIT_OE);
+        }
+    }
+
+    // Recompute the OE windows of a set and apply them to all of its row buffers
+    static void applyBrightness(const uint8_t buf_idx, const uint8_t brightness)
+    {
+        const BufferConfig& config = buffer_config_[buf_idx];
+        const uint8_t first_plane = MATRIX_COLOR_DEPTH - config.depth;
+
+        for (uint8_t k = 0; k < config.depth; k++)
+        {
+            const auto [x_coord_min, x_coord_max] = Encoder::oeWindow(k, config.depth, config.bcm, brightness);
+
+            // (the check is already including "blanking")
+            for (int x_coord = 0; x_coord < MATRIX_PIXELS_PER_ROW; x_coord++)
+            {
+                setOutputEnable(buf_idx, first_plane + k, x_coord, x_coord >= x_coord_min && x_coord < x_coord_max);
+            }
+        }
+
+        applied_brightness_[buf_idx] = brightness;
+    }
+
+    // Move the OE windows of a set to a new brightness. Windows are centered in the row, so only the columns
+    // between the old and new left edge and between the old and new right edge change state.
+    static void updateBrightness(const uint8_t buf_idx, const uint8_t brightness)
+    {
+        const BufferConfig& config = buffer_config_[buf_idx];
+        const uint8_t first_plane = MATRIX_COLOR_DEPTH - config.depth;
+
+        for (uint8_t k = 0; k < config.depth; k++)
+        {
+            const auto [old_min, old_max] = Encoder::oeWindow(k, config.depth, config.bcm,
+                                                              applied_brightness_[buf_idx]);
+            const auto [new_min, new_max] = Encoder::oeWindow(k, config.depth, config.bcm, brightness);
+
+            for (int x_coord = std::min(old_min, new_min); x_coord < std::max(old_min, new_min); x_coord++)
+            {
+                setOutputEnable(buf_idx, first_plane + k, x_coord, x_coord >= new_min && x_coord < new_max);
+            }
+
+            for (int x_coord = std::min(old_max, new_max); x_coord < std::max(old_max, new_max); x_coord++)
+            {
+                setOutputEnable(buf_idx, first_plane + k, x_coord, x_coord >= new_min && x_coord < new_max);
+            }
+        }
+
+        applied_brightness_[buf_idx] = brightness;
     }
 
     static esp_err_t gpioInit(uint32_t pin)
@@ -141,11 +355,6 @@ private:
         return err;
     }
 
-    [[nodiscard]] static int xCoord(const int x_coord) noexcept
-    {
-        return x_coord & 1U ? x_coord - 1 : x_coord + 1;
-    }
-
 public:
     static esp_err_t start()
     {
@@ -169,57 +378,24 @@ public:
         constexpr int iomux_clock = I2S0O_WS_OUT_IDX;
         esp_rom_gpio_connect_out_signal(PIN_CLK, iomux_clock, false, false);
 
-        if ((dma_desc_ = static_cast<lldesc_t*>(heap_caps_malloc(
-            sizeof(lldesc_t) * MATRIX_ROWS_PER_FRAME * MATRIX_COLOR_DEPTH, MALLOC_CAP_DMA))) == nullptr)
+        for (uint8_t b = 0; b < DMA_BUFFER_COUNT; b++)
         {
-            ESP_LOGE(TAG, "Failed to allocate memory for DMA descriptors");
-            return ESP_ERR_NO_MEM;
+            err = allocDmaBuffer(b);
+            if (err != ESP_OK) return err;
         }
 
-        for (size_t r = 0; r < MATRIX_ROWS_PER_FRAME; r++)
+        for (uint8_t b = 0; b < DMA_BUFFER_COUNT; b++)
         {
-            auto abcde = static_cast<uint16_t>(r);
-            abcde <<= BITS_ABCDE_OFFSET;
-
-            for (size_t d = 0; d < MATRIX_COLOR_DEPTH; d++)
-            {
-                const auto row_buf = static_cast<volatile uint16_t*>(
-                    heap_caps_malloc(MATRIX_PIXELS_PER_ROW * sizeof(uint16_t), MALLOC_CAP_DMA));
-
-                if (row_buf == nullptr)
-                {
-                    ESP_LOGE(TAG, "Failed to allocate memory for row buffer");
-                    return ESP_ERR_NO_MEM;
-                }
-
-                for (size_t p = 0; p < MATRIX_PIXELS_PER_ROW; p++)
-                {
-                    if (d == 0)
-                    {
-                        // depth[0] (LSB) x_pixels must be "marked" with the previous's row address,
-                        // because it is used to display the previous row while we pump in LSB's for a new row
-                        row_buf[xCoord(p)] = (static_cast<uint16_t>(r) - 1) << BITS_ABCDE_OFFSET;
-                    }
-                    else
-                    {
-                        row_buf[xCoord(p)] = abcde;
-                    }
-                }
-
-                row_buf[xCoord(MATRIX_PIXELS_PER_ROW - 1)] |= BIT_LAT;
+            applyBrightness(b, brightness_.load());
+        }
 
-                lldesc_t* row_desc = &dma_desc_[r * MATRIX_COLOR_DEPTH + d];
-                const bool is_last = r == MATRIX_ROWS_PER_FRAME - 1 && d == MATRIX_COLOR_DEPTH - 1;
+        front_buffer_.store(0);
+        flip_pending_.store(false);
 
-                row_desc->size = MATRIX_PIXELS_PER_ROW * sizeof(uint16_t);
-                row_desc->length = MATRIX_PIXELS_PER_ROW * sizeof(uint16_t);
-                row_desc->buf = reinterpret_cast<const volatile uint8_t*>(row_buf);
-                row_desc->eof = is_last;
-                row_desc->sosf = 0;
-                row_desc->owner = 1;
-                row_desc->qe.stqe_next = is_last ? &dma_desc_[0] : &dma_desc_[r * MATRIX_COLOR_DEPTH + d + 1];
-                row_desc->offset = 0;
-            }
+        if ((flip_done_ = xSemaphoreCreateBinary()) == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to create flip semaphore");
+            return ESP_ERR_NO_MEM;
         }
 
         i2s_dev_t* dev = &I2S0;
@@ -227,7 +403,7 @@ public:
         dev->clkm_conf.clka_en = 1; // Use the 80mhz system clock (PLL_D2_CLK) when '0'
         dev->clkm_conf.clkm_div_a = 1; // Clock denominator
         dev->clkm_conf.clkm_div_b = 0; // Clock numerator
-        dev->clkm_conf.clkm_div_num = 16;
+        dev->clkm_conf.clkm_div_num = I2S_CLKM_DIV_NUM;
 
         dev->sample_rate_conf.val = 0;
 
@@ -240,7 +416,7 @@ public:
         // ESP32 and ESP32-S2 TRM clearly say that "Note that I2S_TX_BCK_DIV_NUM[5:0] must not be configured
         // as 1."
         dev->sample_rate_conf.rx_bck_div_num = 2;
-        dev->sample_rate_conf.tx_bck_div_num = 2;
+        dev->sample_rate_conf.tx_bck_div_num = I2S_BCK_DIV_NUM;
 
         // I2S conf2 reg
         dev->conf2.val = 0;
@@ -305,8 +481,20 @@ public:
 
         dev->lc_conf.val = I2S_OUT_DATA_BURST_EN | I2S_OUTDSCR_BURST_EN;
 
+        // End-of-frame interrupt completes buffer flips
+        dev->int_ena.val = 0;
+        dev->int_clr.val = 0xFFFFFFFF;
+        err = esp_intr_alloc(ETS_I2S0_INTR_SOURCE, ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_LEVEL1,
+                             onFrameEof, nullptr, &eof_intr_);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to allocate EOF interrupt: %s", esp_err_to_name(err));
+            return err;
+        }
+        dev->int_ena.out_eof = 1;
+
         // Should be last dma_descriptor
-        dev->out_link.addr = reinterpret_cast<uint32_t>(dma_desc_);
+        dev->out_link.addr = reinterpret_cast<uint32_t>(dma_desc_[front_buffer_.load()]);
 
         // Start DMA operation
         dev->out_link.stop = 0;
@@ -314,7 +502,6 @@ public:
 
         dev->conf.tx_start = 1;
 
-        setBrightness(255);
         ESP_LOGI(TAG, "Running");
         return err;
     }
@@ -322,7 +509,12 @@ public:
     static void stop()
     {
         ESP_LOGI(TAG, "Destroying...");
-        if (dma_desc_) heap_caps_free(dma_desc_);
+        if (eof_intr_) esp_intr_free(eof_intr_);
+        for (const auto desc : dma_desc_)
+        {
+            if (desc) heap_caps_free(desc);
+        }
+        if (flip_done_) vSemaphoreDelete(flip_done_);
         ESP_LOGI(TAG, "Destroyed");
     }
 
@@ -331,91 +523,147 @@ public:
         loadFromBuffer(buffer.data());
     }
 
+    // Encode a frame into the back set and queue it for display at the next frame boundary
     static void loadFromBuffer(const volatile uint32_t* buffer)
     {
-        if (buffer == nullptr)
+        if (writeBackBuffer(buffer))
         {
-            return;
+            flipBuffers();
         }
+    }
 
-        for (int r = 0; r < MATRIX_ROWS_PER_FRAME; r++)
-        {
-            for (int d = 0; d < MATRIX_COLOR_DEPTH; d++)
-            {
-                const auto dma_row_buffer = dmaDescAt(r * MATRIX_COLOR_DEPTH + d);
+    // Block until a queued flip has been picked up by the DMA, after which the back set is safe to write
+    static bool waitForFlip(const TickType_t timeout = FLIP_TIMEOUT)
+    {
+        if (!flip_pending_.load()) return true;
+        if (xSemaphoreTake(flip_done_, timeout) == pdTRUE) return true;
 
-                for (int c = 0; c < MATRIX_PIXELS_PER_ROW; c++)
-                {
-                    const uint32_t top_pixel = buffer[r * MATRIX_PIXELS_PER_ROW + c];
-                    const uint32_t bot_pixel = buffer[(r + MATRIX_ROWS_PER_FRAME) * MATRIX_PIXELS_PER_ROW + c];
-                    const uint16_t mask = 1 << (d + MATRIX_COLOR_DEPTH);
-
-                    const int xc = xCoord(c);
-                    dma_row_buffer[xc] &= ~BITMASK_RGB1_RBG2;
-                    dma_row_buffer[xc] |= lumTbl[gammaTbl[top_pixel >> 16 & 0xFF]] & mask ? BIT_R1 : 0;
-                    dma_row_buffer[xc] |= lumTbl[gammaTbl[top_pixel >> 8 & 0xFF]] & mask ? BIT_G1 : 0;
-                    dma_row_buffer[xc] |= lumTbl[gammaTbl[top_pixel & 0xFF]] & mask ? BIT_B1 : 0;
-                    dma_row_buffer[xc] |= lumTbl[gammaTbl[bot_pixel >> 16 & 0xFF]] & mask ? BIT_R2 : 0;
-                    dma_row_buffer[xc] |= lumTbl[gammaTbl[bot_pixel >> 8 & 0xFF]] & mask ? BIT_G2 : 0;
-                    dma_row_buffer[xc] |= lumTbl[gammaTbl[bot_pixel & 0xFF]] & mask ? BIT_B2 : 0;
-                }
-            }
-        }
+        ESP_LOGW(TAG, "Timed out waiting for DMA buffer flip");
+        return false;
     }
 
-    static void setBrightness(const uint8_t brightness)
+    // Link the front set's last descriptor into the back set so the DMA moves over at the end of the frame
+    static void flipBuffers()
     {
-        constexpr uint8_t _depth = MATRIX_COLOR_DEPTH;
-        constexpr uint16_t _width = MATRIX_PIXELS_PER_ROW;
+        if (!waitForFlip()) return;
 
-        // start with iterating all rows in dma_buff structure
-        int row_idx = MATRIX_ROWS_PER_FRAME;
-        do
+        // Drop a completion left over from a flip nobody waited on
+        xSemaphoreTake(flip_done_, 0);
+
+        const uint8_t back = backBuffer();
+        lldesc_t* back_desc = dma_desc_[back];
+        lldesc_t* front_desc = dma_desc_[1 - back];
+
+        back_desc[desc_count_[back] - 1].qe.stqe_next = &back_desc[0];
+        flip_pending_.store(true);
+        front_desc[desc_count_[1 - back] - 1].qe.stqe_next = &back_desc[0];
+    }
+
+    // Encode a frame into the back set without touching what is currently displayed
+    static bool writeBackBuffer(const volatile uint32_t* buffer)
+    {
+        if (buffer == nullptr || !waitForFlip())
         {
-            --row_idx;
+            return false;
+        }
 
-            // let's set OE control bits for specific pixels in each color_index subrows
-            uint8_t color_idx = _depth;
-            do
-            {
-                constexpr uint8_t _blank = 2;
-                --color_idx;
+        const uint8_t back = backBuffer();
 
-                const char bitplane = (2 * _depth - color_idx) % _depth;
-                constexpr char bitshift = (_depth - 2 - 1) >> 1;
+        // Depth, modulation and brightness changes are applied to the back set only, the front set follows on
+        // the next frame
+        const uint8_t brightness = brightness_.load();
+        if (const BufferConfig config{color_depth_.load(), bcm_enabled_.load()}; buffer_config_[back] != config)
+        {
+            buffer_config_[back] = config;
+            linkDmaBuffer(back);
+            applyBrightness(back, brightness);
+            rows_stale_[back] = true;
+        }
+        else if (applied_brightness_[back] != brightness)
+        {
+            updateBrightness(back, brightness);
+        }
 
-                const char rightshift = std::max(bitplane - bitshift - 2, 0);
-                // calculate the OE disable period by brightness and also blanking
-                int brightness_in_x_pixels = ((_width - _blank) * brightness) >> (7 + rightshift);
-                brightness_in_x_pixels = (brightness_in_x_pixels >> 1) | (brightness_in_x_pixels & 1);
+        // The back set holds the frame from two flips ago, so compare against what this set last received
+        const uint32_t encoded = Encoder::encode(buffer, buffer_config_[back].depth, ctrl_bits_[back], row_buf_[back],
+                                                 row_hash_[back], rows_stale_[back]);
+        rows_stale_[back] = false;
 
-                // switch a pointer to a row for a specific color index
-                const auto row = dmaDescAt(row_idx * MATRIX_COLOR_DEPTH + color_idx);
+        rows_encoded_.fetch_add(encoded);
+        rows_skipped_.fetch_add(MATRIX_ROWS_PER_FRAME - encoded);
+        return true;
+    }
 
-                // define the range of Output Enable in the center of the row
-                const int x_coord_max = (_width + brightness_in_x_pixels + 1) >> 1;
-                const int x_coord_min = (_width - brightness_in_x_pixels + 0) >> 1;
-                int x_coord = _width;
-                do
-                {
-                    --x_coord;
+    // Row pairs re-encoded since start, for diagnostics
+    static uint32_t getRowsEncoded()
+    {
+        return rows_encoded_.load();
+    }
 
-                    // (the check is already including "blanking")
-                    if (x_coord >= x_coord_min && x_coord < x_coord_max)
-                    {
-                        row[xCoord(x_coord)] &= ~BIT_OE;
-                    }
-                    else
-                    {
-                        row[xCoord(x_coord)] |= BIT_OE; // Disable output after this point.
-                    }
-                }
-                while (x_coord);
-            }
-            while (color_idx);
+    // Row pairs skipped because their pixels matched the back set since start, for diagnostics
+    static uint32_t getRowsSkipped()
+    {
+        return rows_skipped_.load();
+    }
+
+    // Takes effect with the next frame written, only the OE bits that change are touched
+    static void setBrightness(const uint8_t brightness)
+    {
+        brightness_.store(brightness);
+    }
+
+    static uint8_t getBrightness()
+    {
+        return brightness_.load();
+    }
+
+    // Select 4 to 8 bits per channel, optionally with binary-weighted plane timing. Fewer planes refresh the
+    // panel faster, BCM trades refresh rate for accurate plane weights. Applied from the next frame on.
+    static esp_err_t setColorDepth(const uint8_t depth, const bool bcm = false)
+    {
+        if (depth < MIN_COLOR_DEPTH || depth > MAX_COLOR_DEPTH)
+        {
+            ESP_LOGE(TAG, "Color depth %d out of range [%d, %d]", depth, MIN_COLOR_DEPTH, MAX_COLOR_DEPTH);
+            return ESP_ERR_INVALID_ARG;
         }
-        while (row_idx);
+
+        color_depth_.store(depth);
+        bcm_enabled_.store(bcm);
+
+        const size_t words = MATRIX_ROWS_PER_FRAME * (descPerRow(depth, bcm) * MATRIX_PIXELS_PER_ROW);
+        ESP_LOGI(TAG, "Color depth %d%s, refresh rate %lu Hz", depth, bcm ? " (BCM)" : "",
+                 static_cast<unsigned long>(MATRIX_PIXEL_CLOCK_HZ / words));
+        return ESP_OK;
+    }
+
+    static uint8_t getColorDepth()
+    {
+        return color_depth_.load();
+    }
+
+    // Panel refresh rate of the frame currently being scanned out
+    static uint32_t getRefreshRateHz()
+    {
+        return MATRIX_PIXEL_CLOCK_HZ / (desc_count_[front_buffer_.load()] * MATRIX_PIXELS_PER_ROW);
     }
 };
 
-lldesc_t* MatrixDriver::dma_desc_;
+std::array<lldesc_t*, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::dma_desc_;
+std::array<MatrixDriver::Encoder::RowBuffers, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::row_buf_;
+std::array<size_t, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::desc_count_;
+std::array<MatrixDriver::BufferConfig, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::buffer_config_;
+std::atomic<uint8_t> MatrixDriver::color_depth_{MatrixDriver::MAX_COLOR_DEPTH};
+std::atomic<bool> MatrixDriver::bcm_enabled_{false};
+std::atomic<uint8_t> MatrixDriver::brightness_{255};
+std::array<uint8_t, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::applied_brightness_;
+std::atomic<uint8_t> MatrixDriver::front_buffer_{0};
+std::atomic<bool> MatrixDriver::flip_pending_{false};
+SemaphoreHandle_t MatrixDriver::flip_done_;
+intr_handle_t MatrixDriver::eof_intr_;
+std::array<MatrixDriver::Encoder::RowHashes, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::row_hash_;
+std::array<bool, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::rows_stale_;
+std::atomic<uint32_t> MatrixDriver::rows_encoded_{0};
+std::atomic<uint32_t> MatrixDriver::rows_skipped_{0};
+std::array<MatrixDriver::Encoder::CtrlBits, MatrixDriver::DMA_BUFFER_COUNT> MatrixDriver::ctrl_bits_;
+
+#endif
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "esp_attr.h"
+
+/**
+ * @brief Hardware-independent half of MatrixDriver: turns frames into the 16-bit words the I2S peripheral shifts out
+ * @tparam TGeometry PanelGeometry of the chain
+ *
+ * A row pair is held in one row buffer per bit-plane, COLOR_DEPTH of them, each PIXELS_PER_ROW words of RGB1/RGB2,
+ * row address, LAT and OE bits in the pin order below. MatrixDriver owns the buffers and the DMA descriptors
+ * walking them, this only fills them, so the encoder builds and is tested on the host.
+ */
+template <typename TGeometry>
+class MatrixEncoder final
+{
+public:
+    using Geometry = TGeometry;
+
+    static constexpr uint8_t ROWS_PER_FRAME = Geometry::ROWS_PER_FRAME;
+    static constexpr uint16_t PIXELS_PER_ROW = Geometry::PIXELS_PER_ROW;
+    static constexpr uint8_t COLOR_DEPTH = 8;
+
+    // Planes below BCM_LSB_PLANES are shortened through their OE window when binary code modulation is on
+    static constexpr uint8_t BCM_LSB_PLANES = 3;
+
+    static constexpr uint16_t BIT_R1 = 1 << 0;
+    static constexpr uint16_t BIT_G1 = 1 << 1;
+    static constexpr uint16_t BIT_B1 = 1 << 2;
+    static constexpr uint16_t BIT_R2 = 1 << 3;
+    static constexpr uint16_t BIT_G2 = 1 << 4;
+    static constexpr uint16_t BIT_B2 = 1 << 5;
+    static constexpr uint16_t BIT_A = 1 << 8;
+    static constexpr uint16_t BIT_B = 1 << 9;
+    static constexpr uint16_t BIT_C = 1 << 10;
+    static constexpr uint16_t BIT_D = 1 << 11;
+    static constexpr uint16_t BIT_E = 1 << 12;
+    static constexpr uint16_t BIT_LAT = 1 << 6;
+    static constexpr uint16_t BIT_OE = 1 << 7;
+    static constexpr uint16_t BIT_CLK = 1 << 13;
+
+    static constexpr uint16_t BITMASK_RGB1 = BIT_R1 | BIT_G1 | BIT_B1;
+    static constexpr uint16_t BITMASK_RGB2 = BIT_R2 | BIT_G2 | BIT_B2;
+    static constexpr uint16_t BITMASK_RGB1_RBG2 = BITMASK_RGB1 | BITMASK_RGB2;
+    static constexpr uint16_t BITMASK_ABCDE = BIT_A | BIT_B | BIT_C | BIT_D | BIT_E;
+    static constexpr int BITS_ABCDE_OFFSET = 8;
+
+    // Non-color bits (LAT and OE) of every column per bit-plane
+    using CtrlBits = std::array<std::array<uint16_t, PIXELS_PER_ROW>, COLOR_DEPTH>;
+    // Row buffers of one set, row r plane d at r * COLOR_DEPTH + d
+    using RowBuffers = std::array<volatile uint16_t*, ROWS_PER_FRAME * COLOR_DEPTH>;
+    // Hash of the pixels last encoded into each row pair
+    using RowHashes = std::array<uint32_t, ROWS_PER_FRAME>;
+
+    MatrixEncoder() = delete;
+
+    static constexpr uint16_t DRAM_ATTR lumTbl[] = {
+        0, 27, 56, 84, 113, 141, 170, 198, 227, 255, 284, 312, 340, 369,
+        397, 426, 454, 483, 511, 540, 568, 597, 626, 657, 688, 720, 754, 788,
+        824, 860, 898, 936, 976, 1017, 1059, 1102, 1146, 1191, 1238, 1286, 1335, 1385,
+        1436, 1489, 1543, 1598, 1655, 1713, 1772, 1833, 1895, 1958, 2023, 2089, 2156, 2225,
+        2296, 2368, 2441, 2516, 2592, 2670, 2750, 2831, 2914, 2998, 3084, 3171, 3260, 3351,
+        3443, 3537, 3633, 3731, 3830, 3931, 4034, 4138, 4245, 4353, 4463, 4574, 4688, 4803,
+        4921, 5040, 5161, 5284, 5409, 5536, 5665, 5796, 5929, 6064, 6201, 6340, 6482, 6625,
+        6770, 6917, 7067, 7219, 7372, 7528, 7687, 7847, 8010, 8174, 8341, 8511, 8682, 8856,
+        9032, 9211, 9392, 9575, 9761, 9949, 10139, 10332, 10527, 10725, 10925, 11127, 11332, 11540,
+        11750, 11963, 12178, 12395, 12616, 12839, 13064, 13292, 13523, 13757, 13993, 14231, 14473, 14717,
+        14964, 15214, 15466, 15722, 15980, 16240, 16504, 16771, 17040, 17312, 17587, 17865, 18146, 18430,
+        18717, 19006, 19299, 19595, 19894, 20195, 20500, 20808, 21119, 21433, 21750, 22070, 22393, 22720,
+        23049, 23382, 23718, 24057, 24400, 24745, 25094, 25446, 25802, 26160, 26522, 26888, 27256, 27628,
+        28004, 28382, 28765, 29150, 29539, 29932, 30328, 30727, 31130, 31536, 31946, 32360, 32777, 33197,
+        33622, 34049, 34481, 34916, 35354, 35797, 36243, 36692, 37146, 37603, 38064, 38528, 38996, 39469,
+        39945, 40424, 40908, 41395, 41886, 42382, 42881, 43383, 43890, 44401, 44916, 45434, 45957, 46484,
+        47014, 47549, 48088, 48630, 49177, 49728, 50283, 50842, 51406, 51973, 52545, 53120, 53700, 54284,
+        54873, 55465, 56062, 56663, 57269, 57878, 58492, 59111, 59733, 60360, 60992, 61627, 62268, 62912,
+        63561, 64215, 64873, 65535
+    };
+
+    static constexpr uint8_t DRAM_ATTR gammaTbl[] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+        1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
+        4, 4, 5, 5, 5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9,
+        9, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16,
+        16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22, 23, 23, 24, 24,
+        25, 26, 26, 27, 28, 28, 29, 30, 30, 31, 32, 32, 33, 34, 35, 35,
+        36, 37, 38, 38, 39, 40, 41, 42, 42, 43, 44, 45, 46, 47, 47, 48,
+        49, 50, 51, 52, 53, 54, 55, 56, 56, 57, 58, 59, 60, 61, 62, 63,
+        64, 65, 66, 67, 68, 69, 70, 71, 73, 74, 75, 76, 77, 78, 79, 80,
+        81, 82, 84, 85, 86, 87, 88, 89, 91, 92, 93, 94, 95, 97, 98, 99,
+        100, 102, 103, 104, 105, 107, 108, 109, 111, 112, 113, 115, 116, 117, 119, 120,
+        121, 123, 124, 126, 127, 128, 130, 131, 133, 134, 136, 137, 139, 140, 142, 143,
+        145, 146, 148, 149, 151, 152, 154, 155, 157, 158, 160, 162, 163, 165, 166, 168,
+        170, 171, 173, 175, 176, 178, 180, 181, 183, 185, 186, 188, 190, 192, 193, 195,
+        197, 199, 200, 202, 204, 206, 207, 209, 211, 213, 215, 217, 218, 220, 222, 224,
+        226, 228, 230, 232, 233, 235, 237, 239, 241, 243, 245, 247, 249, 251, 253, 255,
+    };
+
+    // Fused gamma + luminance table: entry v has bit (8 * d) set when bit-plane d of the output code for
+    // channel value v is lit, so shifting it by a channel's pin index yields that channel for all planes at once
+    static constexpr std::array<uint64_t, 256> DRAM_ATTR planeTbl = []
+    {
+        std::array<uint64_t, 256> tbl{};
+        for (size_t v = 0; v < tbl.size(); v++)
+        {
+            for (size_t d = 0; d < COLOR_DEPTH; d++)
+            {
+                if (lumTbl[gammaTbl[v]] & 1 << (d + COLOR_DEPTH))
+                {
+                    tbl[v] |= static_cast<uint64_t>(1) << (d * 8);
+                }
+            }
+        }
+        return tbl;
+    }();
+
+    // Column pairs are swapped, the I2S FIFO sends the upper half of each 32-bit word first
+    [[nodiscard]] static constexpr int xCoord(const int x_coord) noexcept
+    {
+        return x_coord & 1U ? x_coord - 1 : x_coord + 1;
+    }
+
+    // Right shift of the OE window in the row buffer of the k-th active plane. That buffer still shows the
+    // plane below while its own plane shifts in, so the window sets how long the previous plane is lit.
+    [[nodiscard]] static int oeShift(const uint8_t k, const uint8_t depth, const bool bcm)
+    {
+        if (bcm)
+        {
+            return k == 0 ? 0 : std::max(BCM_LSB_PLANES - (k - 1), 0);
+        }
+
+        const int bitplane = (2 * depth - k) % depth;
+        const int bitshift = (depth - 2 - 1) >> 1;
+        return std::max(bitplane - bitshift - 2, 0);
+    }
+
+    // Columns [first, second) of the k-th active plane's row buffer have output enabled
+    [[nodiscard]] static std::pair<int, int> oeWindow(const uint8_t k, const uint8_t depth, const bool bcm,
+                                                      const uint8_t brightness)
+    {
+        constexpr uint8_t _blank = 2;
+        constexpr uint16_t _width = PIXELS_PER_ROW;
+
+        const int rightshift = oeShift(k, depth, bcm);
+
+        // calculate the OE disable period by brightness and also blanking
+        int brightness_in_x_pixels = ((_width - _blank) * brightness) >> (7 + rightshift);
+        brightness_in_x_pixels = (brightness_in_x_pixels >> 1) | (brightness_in_x_pixels & 1);
+
+        // define the range of Output Enable in the center of the row
+        const int x_coord_max = (_width + brightness_in_x_pixels + 1) >> 1;
+        const int x_coord_min = (_width - brightness_in_x_pixels + 0) >> 1;
+        return {x_coord_min, x_coord_max};
+    }
+
+    // FNV-1a over whole pixels of a row pair
+    [[nodiscard]] static uint32_t rowHash(const volatile uint32_t* buffer, const typename Geometry::PixelPair* row_map)
+    {
+        uint32_t hash = 2166136261u;
+        for (int c = 0; c < PIXELS_PER_ROW; c++)
+        {
+            hash = (hash ^ buffer[row_map[c].top]) * 16777619u;
+            hash = (hash ^ buffer[row_map[c].bot]) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Write row pair r of a frame into the row buffers of planes [first_plane, COLOR_DEPTH)
+    static void encodeRow(const volatile uint32_t* buffer, const int r, const uint8_t first_plane,
+                          const CtrlBits& ctrl_bits, const RowBuffers& row_bufs)
+    {
+        const typename Geometry::PixelPair* row_map = &Geometry::MAP[r * PIXELS_PER_ROW];
+
+        std::array<volatile uint16_t*, COLOR_DEPTH> planes{};
+        for (int d = first_plane; d < COLOR_DEPTH; d++)
+        {
+            planes[d] = row_bufs[r * COLOR_DEPTH + d];
+        }
+
+        // the least significant active plane keeps the previous row's address, see MatrixDriver::allocDmaBuffer()
+        const auto abcde = static_cast<uint16_t>(r << BITS_ABCDE_OFFSET);
+        const auto prev_abcde = static_cast<uint16_t>((r - 1) << BITS_ABCDE_OFFSET);
+
+        for (int c = 0; c < PIXELS_PER_ROW; c++)
+        {
+            const uint32_t top_pixel = buffer[row_map[c].top];
+            const uint32_t bot_pixel = buffer[row_map[c].bot];
+
+            // Byte d holds the six RGB1/RGB2 bits of bit-plane d
+            const uint64_t bits = planeTbl[top_pixel >> 16 & 0xFF]
+                | planeTbl[top_pixel >> 8 & 0xFF] << 1
+                | planeTbl[top_pixel & 0xFF] << 2
+                | planeTbl[bot_pixel >> 16 & 0xFF] << 3
+                | planeTbl[bot_pixel >> 8 & 0xFF] << 4
+                | planeTbl[bot_pixel & 0xFF] << 5;
+
+            const int xc = xCoord(c);
+            for (int d = first_plane; d < COLOR_DEPTH; d++)
+            {
+                planes[d][xc] = static_cast<uint16_t>((d == first_plane ? prev_abcde : abcde) | ctrl_bits[d][c] |
+                    (bits >> (d * 8) & BITMASK_RGB1_RBG2));
+            }
+        }
+    }
+
+    // Encode the row pairs of a frame whose hash differs from row_hashes, or all of them if stale, at depth bits
+    // per channel. Returns the number of row pairs written.
+    static uint32_t encode(const volatile uint32_t* buffer, const uint8_t depth, const CtrlBits& ctrl_bits,
+                           const RowBuffers& row_bufs, RowHashes& row_hashes, const bool stale)
+    {
+        const uint8_t first_plane = COLOR_DEPTH - depth;
+        uint32_t encoded = 0;
+
+        for (int r = 0; r < ROWS_PER_FRAME; r++)
+        {
+            const uint32_t hash = rowHash(buffer, &Geometry::MAP[r * PIXELS_PER_ROW]);
+            if (!stale && hash == row_hashes[r]) continue;
+            row_hashes[r] = hash;
+            encoded++;
+
+            encodeRow(buffer, r, first_plane, ctrl_bits, row_bufs);
+        }
+
+        return encoded;
+    }
+};
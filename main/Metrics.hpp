@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdint>
+
+#include "sdkconfig.h"
+
+// Pipeline stages timed by TOTEM_METRICS_SCOPE, and latencies recorded with Metrics::recordUs
+enum class MetricStage : uint8_t
+{
+    RENDER,
+    BLEND,
+    ENCODE,
+    FFT,
+    HTTP,
+    AUDIO_TO_PHOTON,
+    COUNT,
+};
+
+#if CONFIG_TOTEM_METRICS
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nlohmann/json.hpp"
+
+/**
+ * @brief Per-stage cycle-count histograms and task stack high-water marks
+ *
+ * Recording a sample is two cycle counter reads and a handful of relaxed atomics, so every stage can stay timed in
+ * production builds. With CONFIG_TOTEM_METRICS disabled this class does not exist and the macros expand to nothing.
+ */
+class Metrics final
+{
+    static constexpr auto TAG = "Metrics";
+
+public:
+    static constexpr size_t MAX_TASKS = 8;
+
+    Metrics() = delete;
+
+    // Times the enclosing scope, use through TOTEM_METRICS_SCOPE
+    class Scope final
+    {
+        const MetricStage stage_;
+        const uint32_t start_;
+
+    public:
+        explicit Scope(const MetricStage stage) : stage_(stage), start_(esp_cpu_get_cycle_count())
+        {
+        }
+
+        ~Scope()
+        {
+            record(stage_, esp_cpu_get_cycle_count() - start_);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    static constexpr uint32_t CPU_MHZ = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+
+    // Log-linear buckets, SUB_BUCKETS per power of two of cycles, everything below 2^MIN_EXP lands in bucket 0
+    static constexpr uint8_t SUB_BITS = 3;
+    static constexpr uint8_t SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr uint8_t MIN_EXP = 8;
+    static constexpr uint8_t MAX_EXP = 31;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXP - MIN_EXP + 1) * SUB_BUCKETS;
+
+    static constexpr std::array<const char*, static_cast<size_t>(MetricStage::COUNT)> STAGE_NAMES = {
+        "render", "blend", "encode", "fft", "http", "audio_to_photon",
+    };
+
+    struct Stage
+    {
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint32_t> min_cycles{UINT32_MAX};
+        std::atomic<uint32_t> max_cycles{0};
+        std::atomic<uint64_t> total_cycles{0};
+        std::array<std::atomic<uint32_t>, BUCKET_COUNT> buckets{};
+    };
+
+    struct Task
+    {
+        std::atomic<TaskHandle_t> handle{nullptr};
+        std::atomic<const char*> name{nullptr};
+    };
+
+    static std::array<Stage, static_cast<size_t>(MetricStage::COUNT)> stages_;
+    static std::array<Task, MAX_TASKS> tasks_;
+
+    static size_t bucketOf(const uint32_t cycles)
+    {
+        if (cycles < (1u << MIN_EXP)) return 0;
+
+        const uint8_t exp = std::bit_width(cycles) - 1;
+        const uint8_t sub = (cycles >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return (exp - MIN_EXP) * SUB_BUCKETS + sub;
+    }
+
+    // Largest cycle count that falls into a bucket
+    static uint64_t bucketLimit(const size_t bucket)
+    {
+        const uint8_t exp = MIN_EXP + bucket / SUB_BUCKETS;
+        const uint64_t sub = bucket % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << (exp - SUB_BITS)) - 1;
+    }
+
+    static uint32_t toUs(const uint64_t cycles)
+    {
+        return static_cast<uint32_t>(cycles / CPU_MHZ);
+    }
+
+public:
+    static void record(const MetricStage stage, const uint32_t cycles)
+    {
+        Stage& s = stages_[static_cast<size_t>(stage)];
+        s.count.fetch_add(1, std::memory_order_relaxed);
+        s.total_cycles.fetch_add(cycles, std::memory_order_relaxed);
+        s.buckets[bucketOf(cycles)].fetch_add(1, std::memory_order_relaxed);
+
+        uint32_t prev = s.min_cycles.load(std::memory_order_relaxed);
+        while (cycles < prev && !s.min_cycles.compare_exchange_weak(prev, cycles, std::memory_order_relaxed))
+        {
+        }
+
+        prev = s.max_cycles.load(std::memory_order_relaxed);
+        while (cycles > prev && !s.max_cycles.compare_exchange_weak(prev, cycles, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // For spans measured with esp_timer rather than the cycle counter, such as across tasks
+    static void recordUs(const MetricStage stage, const int64_t us)
+    {
+        const uint64_t cycles = static_cast<uint64_t>(std::max<int64_t>(us, 0)) * CPU_MHZ;
+        record(stage, static_cast<uint32_t>(std::min<uint64_t>(cycles, UINT32_MAX)));
+    }
+
+    // Track the calling task's stack high-water mark under the given name, which must outlive the task
+    static void registerTask(const char* name)
+    {
+        const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+        for (auto& task : tasks_)
+        {
+            TaskHandle_t expected = nullptr;
+            if (task.handle.load() == nullptr && task.handle.compare_exchange_strong(expected, self))
+            {
+                task.name.store(name);
+                return;
+            }
+        }
+        ESP_LOGW(TAG, "No free task slot for %s", name);
+    }
+
+    static void unregisterTask()
+    {
+        const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+        for (auto& task : tasks_)
+        {
+            if (task.handle.load() == self)
+            {
+                task.name.store(nullptr);
+                task.handle.store(nullptr);
+            }
+        }
+    }
+
+    static void reset()
+    {
+        for (auto& s : stages_)
+        {
+            s.count.store(0, std::memory_order_relaxed);
+            s.min_cycles.store(UINT32_MAX, std::memory_order_relaxed);
+            s.max_cycles.store(0, std::memory_order_relaxed);
+            s.total_cycles.store(0, std::memory_order_relaxed);
+            for (auto& bucket : s.buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Stages as [count, min, avg, max, p99] in microseconds, stacks as free bytes at the high-water mark
+    static nlohmann::json toJson()
+    {
+        nlohmann::json root;
+
+        for (size_t i = 0; i < stages_.size(); i++)
+        {
+            const Stage& s = stages_[i];
+            const uint32_t count = s.count.load(std::memory_order_relaxed);
+            if (count == 0) continue;
+
+            // p99 is the upper edge of the bucket holding the 99th percentile sample, clamped to the observed max
+            const uint32_t max_cycles = s.max_cycles.load(std::memory_order_relaxed);
+            const uint32_t rank = count - count / 100;
+            uint32_t seen = 0;
+            uint64_t p99_cycles = max_cycles;
+            for (size_t b = 0; b < BUCKET_COUNT; b++)
+            {
+                seen += s.buckets[b].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                {
+                    p99_cycles = std::min<uint64_t>(bucketLimit(b), max_cycles);
+                    break;
+                }
+            }
+
+            root["stages"][STAGE_NAMES[i]] = nlohmann::json::array({
+                count,
+                toUs(s.min_cycles.load(std::memory_order_relaxed)),
+                toUs(s.total_cycles.load(std::memory_order_relaxed) / count),
+                toUs(max_cycles),
+                toUs(p99_cycles),
+            });
+        }
+
+        for (const auto& task : tasks_)
+        {
+            const TaskHandle_t handle = task.handle.load();
+            if (const char* name = task.name.load(); handle != nullptr && name != nullptr)
+            {
+                root["stacks"][name] = uxTaskGetStackHighWaterMark(handle);
+            }
+        }
+
+        return root;
+    }
+};
+
+#define TOTEM_METRICS_CONCAT_IMPL(a, b) a##b
+#define TOTEM_METRICS_CONCAT(a, b) TOTEM_METRICS_CONCAT_IMPL(a, b)
+#define TOTEM_METRICS_SCOPE(stage) const Metrics::Scope TOTEM_METRICS_CONCAT(metrics_scope_, __LINE__){stage}
+
+std::array<Metrics::Stage, static_cast<size_t>(MetricStage::COUNT)> Metrics::stages_;
+std::array<Metrics::Task, Metrics::MAX_TASKS> Metrics::tasks_;
+
+#else
+
+#define TOTEM_METRICS_SCOPE(stage) static_cast<void>(0)
+
+#endif
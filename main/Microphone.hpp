@@ -1,12 +1,22 @@
 ﻿#pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 #include <array>
-#include <mutex>
+#include <cstring>
 #include <driver/i2s_std.h>
 
-#include "util/Fft.hpp"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "Metrics.hpp"
+#include "util/AudioFeatures.hpp"
+#include "util/Filterbank.hpp"
+#include "util/SampleRing.hpp"
+#include "util/SeqLock.hpp"
+#include "util/Spectrum.hpp"
+#include "util/SpscQueue.hpp"
 #include "util/ThreadManager.hpp"
 
 /**
@@ -17,27 +27,82 @@ class Microphone final
 public:
     static constexpr size_t SAMPLE_RATE = 22050;
     static constexpr size_t BUFFER_SIZE = 512;
-    static constexpr size_t MAX_FREQ_BINS = 64; // Maximum number of frequency bins we'll support
+    static constexpr size_t MAX_FREQ_BINS = 64; // Maximum number of frequency bands we'll support
+    using Spectrum = std::array<float, MAX_FREQ_BINS>;
+    using Features = util::AudioFeatures<MAX_FREQ_BINS>;
+
+    // Everything the processing thread publishes for one hop
+    struct Analysis
+    {
+        Spectrum bands;
+        Features features;
+        int64_t captured_us; // Capture time of the newest sample in the window, 0 before the first
+    };
+
+    // New samples per analysis, consecutive windows share the rest
+    static constexpr size_t HOP_SIZE = BUFFER_SIZE * (100 - CONFIG_TOTEM_MIC_OVERLAP_PERCENT) / 100;
+    static_assert(HOP_SIZE > 0 && HOP_SIZE <= BUFFER_SIZE, "Overlap must leave at least one new sample per hop");
+
+    // Range the log and mel bands cover
+    static constexpr float BAND_MIN_HZ = 40.0f;
+    static constexpr float BAND_MAX_HZ = 10000.0f;
 
     Microphone() = delete;
 
 private:
     static constexpr auto TAG = "Microphone";
 
-    // Microphone data acquisition 
-    static std::mutex read_mic_mutex_;
-    static std::array<int32_t, BUFFER_SIZE> buffer_;
+    // One DMA buffer per hop, each completed buffer is copied out by the receive callback
+    static constexpr uint32_t DMA_BUFFERS = 4;
+    static constexpr size_t HOP_QUEUE_DEPTH = 4;
+    // Bounds how long a stop request waits for the processing thread when no audio arrives
+    static constexpr TickType_t HOP_WAIT = pdMS_TO_TICKS(100);
+
+    struct Hop
+    {
+        int64_t captured_us; // When the DMA buffer completed, the capture time of its newest sample
+        uint32_t count;
+        std::array<int32_t, HOP_SIZE> samples;
+    };
+
+    // Microphone data acquisition
+    static util::SpscQueue<Hop, HOP_QUEUE_DEPTH> hops_;
+    static std::atomic<uint32_t> overruns_; // Hops dropped because the processing thread fell behind
+    static std::atomic<TaskHandle_t> processing_task_;
+    static util::SampleRing<int32_t, BUFFER_SIZE> window_;
     static i2s_chan_handle_t rx_chan_;
 
+    // Spectrum analysis selected in Kconfig, holds the processing thread's working buffer
+#if CONFIG_TOTEM_MIC_SPECTRUM_GOERTZEL
+    using SpectrumAnalyzer = util::GoertzelSpectrum<BUFFER_SIZE>;
+#elif CONFIG_TOTEM_MIC_FIXED_POINT
+    using SpectrumAnalyzer = util::FixedSpectrum<BUFFER_SIZE>;
+#else
+    using SpectrumAnalyzer = util::FloatSpectrum<BUFFER_SIZE>;
+#endif
+    static SpectrumAnalyzer analyzer_;
+
+#if !CONFIG_TOTEM_MIC_SPECTRUM_GOERTZEL
+    // Every bin up to Nyquist, folded into MAX_FREQ_BINS bands on the scale chosen in Kconfig
+#if CONFIG_TOTEM_MIC_BANDS_MEL
+    static constexpr util::BandScale BAND_SCALE = util::BandScale::MEL;
+#elif CONFIG_TOTEM_MIC_BANDS_LOG
+    static constexpr util::BandScale BAND_SCALE = util::BandScale::LOG;
+#else
+    static constexpr util::BandScale BAND_SCALE = util::BandScale::LINEAR;
+#endif
+    static std::array<float, BUFFER_SIZE / 2> bins_;
+    static const util::Filterbank<BUFFER_SIZE / 2, MAX_FREQ_BINS> filterbank_;
+#endif
+    // Onsets, tempo and levels, computed once per hop for every pattern
+    static util::AudioFeatureTracker<MAX_FREQ_BINS> feature_tracker_;
+
     // Thread management
     static ThreadManager* processing_thread_;
     static std::atomic<bool> thread_initialized_;
 
-    // Double-buffering system for spectrum data
-    static std::mutex spectrum_mutex_;
-    static std::array<float, MAX_FREQ_BINS> spectrum_buffer_[2]; // Double buffer
-    static std::atomic<uint8_t> active_buffer_; // Which buffer is currently being read by clients
-    static std::atomic<uint32_t> update_count_; // Counter to track updates for clients
+    // Spectrum publication, lock-free for any number of readers
+    static util::SeqLock<Analysis> analysis_; // Latest bands, its sequence number counts the updates
     static std::atomic<uint32_t> processing_time_us_; // Time taken for processing
 
     struct Pin
@@ -47,97 +112,83 @@ private:
         static constexpr gpio_num_t SD = GPIO_NUM_32;
     };
 
+    // Runs in the I2S interrupt for every filled DMA buffer, queues it as a hop and wakes the processing thread
+    static IRAM_ATTR bool onReceive(i2s_chan_handle_t, i2s_event_data_t* event, void*)
+    {
+        const int64_t now_us = esp_timer_get_time();
+
+        Hop* hop = hops_.write_slot();
+        if (hop == nullptr)
+        {
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        hop->captured_us = now_us;
+        hop->count = std::min(event->size / sizeof(int32_t), HOP_SIZE);
+        std::memcpy(hop->samples.data(), event->dma_buf, hop->count * sizeof(int32_t));
+        hops_.push();
+
+        BaseType_t woken = pdFALSE;
+        if (const TaskHandle_t task = processing_task_.load(std::memory_order_acquire))
+        {
+            vTaskNotifyGiveFromISR(task, &woken);
+        }
+        return woken == pdTRUE;
+    }
+
     // Thread function for FFT processing
     static void processingThreadFunc(const std::atomic<bool>& running)
     {
-        std::vector<std::complex<float>> fft_input(BUFFER_SIZE);
         std::array<int32_t, BUFFER_SIZE> local_buffer{};
-        std::array<float, MAX_FREQ_BINS> local_spectrum{};
+        Analysis local_analysis{};
 
-        ESP_LOGI(TAG, "FFT processing thread started on core %d", xPortGetCoreID());
+        ESP_LOGI(TAG, "FFT processing thread started on core %d, %zu sample hop", xPortGetCoreID(), HOP_SIZE);
 
-        uint32_t last_process_time = 0;
+        window_.clear();
+        processing_task_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
 
         while (running)
         {
-            // Don't process too frequently to avoid CPU overload
-            if (constexpr uint32_t min_interval_ms = 30;
-                esp_timer_get_time() / 1000 - last_process_time < min_interval_ms)
-            {
-                vTaskDelay(pdMS_TO_TICKS(5));
-                continue;
-            }
+            // Sleeps until the receive callback queues a hop, so a spectrum is at most one hop behind the audio. A
+            // timeout still checks the queue, hops queued before this task was registered woke nobody.
+            ulTaskNotifyTake(pdTRUE, HOP_WAIT);
 
-            // Read microphone data with timeout
-            size_t bytes_read = 0;
+            // Slide the window over everything that arrived, a late thread analyses only the newest window
+            bool fresh = false;
+            while (const Hop* hop = hops_.read_slot())
             {
-                std::lock_guard lock(read_mic_mutex_);
-                const esp_err_t err = i2s_channel_read(rx_chan_, buffer_.data(),
-                                                       BUFFER_SIZE * sizeof(int32_t),
-                                                       &bytes_read, 100 / portTICK_PERIOD_MS); // 100ms timeout
-
-                if (err != ESP_OK)
-                {
-                    // Just skip this cycle if there's an error
-                    vTaskDelay(pdMS_TO_TICKS(10));
-                    continue;
-                }
-
-                // Copy to local buffer for processing
-                std::memcpy(local_buffer.data(), buffer_.data(), sizeof(local_buffer));
+                window_.push(std::span<const int32_t>(hop->samples.data(), hop->count));
+                local_analysis.captured_us = hop->captured_us;
+                hops_.pop();
+                fresh = true;
             }
-
-            if (bytes_read < BUFFER_SIZE * sizeof(int32_t))
+            if (!fresh)
             {
-                // Pad with zeros if we didn't get a full buffer
-                for (size_t i = bytes_read / sizeof(int32_t); i < BUFFER_SIZE; ++i)
-                {
-                    local_buffer[i] = 0;
-                }
-            }
-
-            const auto start_time = esp_timer_get_time();
-
-            // Prepare FFT input with window function
-            for (size_t i = 0; i < BUFFER_SIZE; ++i)
-            {
-                const float cos_res = cosf(2.0f * M_PI * static_cast<float>(i) / static_cast<float>(BUFFER_SIZE - 1));
-                const float window_val = 0.5f * (1.0f - cos_res);
-                const float sample_float = static_cast<float>(local_buffer[i] >> 16) / 32768.0f;
-                fft_input[i] = std::complex(sample_float * window_val, 0.0f);
+                continue;
             }
 
-            // Perform FFT
-            util::fft(fft_input);
+            window_.copy_to(local_buffer);
 
-            // Calculate magnitude spectrum
-            for (size_t i = 0; i < MAX_FREQ_BINS; ++i)
+            const auto start_time = esp_timer_get_time();
             {
-                const float real_part = fft_input[i].real();
-                const float imag_part = fft_input[i].imag();
-                local_spectrum[i] = std::sqrtf(real_part * real_part + imag_part * imag_part);
+                TOTEM_METRICS_SCOPE(MetricStage::FFT);
+#if CONFIG_TOTEM_MIC_SPECTRUM_GOERTZEL
+                analyzer_.compute(local_buffer, local_analysis.bands);
+#else
+                analyzer_.compute(local_buffer, bins_);
+                filterbank_.apply(bins_, local_analysis.bands);
+#endif
+                feature_tracker_.update(local_analysis.bands, local_analysis.features);
             }
 
             // Track processing time
             processing_time_us_.store(esp_timer_get_time() - start_time);
-            last_process_time = esp_timer_get_time() / 1000;
 
-            // Store results in inactive buffer
-            const uint8_t write_buffer = 1 - active_buffer_.load();
-            {
-                std::lock_guard lock(spectrum_mutex_);
-                std::memcpy(spectrum_buffer_[write_buffer].data(), local_spectrum.data(),
-                            sizeof(float) * MAX_FREQ_BINS);
-            }
-
-            // Switch active buffer
-            active_buffer_.store(write_buffer);
-            update_count_.fetch_add(1);
-
-            // Yield to other tasks
-            vTaskDelay(pdMS_TO_TICKS(1));
+            analysis_.publish(local_analysis);
         }
 
+        processing_task_.store(nullptr, std::memory_order_release);
         ESP_LOGI(TAG, "FFT processing thread ended");
     }
 
@@ -146,22 +197,16 @@ public:
     {
         ESP_LOGI(TAG, "Starting Microphone and FFT processing...");
 
-        // Initialize spectrum buffers
-        for (auto& buffer : spectrum_buffer_)
-        {
-            buffer.fill(0.0f);
-        }
-
-        active_buffer_.store(0);
-        update_count_.store(0);
         processing_time_us_.store(0);
+        overruns_.store(0);
         thread_initialized_.store(false);
+        hops_.reset(); // Hops stop() left undrained
 
         constexpr i2s_chan_config_t chan_cfg = {
             .id = I2S_NUM_1,
             .role = I2S_ROLE_MASTER,
-            .dma_desc_num = 8,
-            .dma_frame_num = BUFFER_SIZE / 2,
+            .dma_desc_num = DMA_BUFFERS,
+            .dma_frame_num = HOP_SIZE,
             .auto_clear = true,
             .auto_clear_before_cb = true,
             .allow_pd = false,
@@ -200,6 +245,22 @@ public:
             return err;
         }
 
+        // Callbacks can only be registered before the channel is enabled
+        constexpr i2s_event_callbacks_t callbacks = {
+            .on_recv = onReceive,
+            .on_recv_q_ovf = nullptr,
+            .on_sent = nullptr,
+            .on_send_q_ovf = nullptr,
+        };
+
+        err = i2s_channel_register_event_callback(rx_chan_, &callbacks, nullptr);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to register I2S RX callback: %s", esp_err_to_name(err));
+            i2s_del_channel(rx_chan_);
+            return err;
+        }
+
         err = i2s_channel_enable(rx_chan_);
         if (err != ESP_OK)
         {
@@ -230,7 +291,12 @@ public:
     {
         ESP_LOGI(TAG, "Destroying Microphone and FFT processing...");
 
-        // Stop processing thread first
+        // Stop the receive callbacks first, they wake the processing thread
+        if (rx_chan_)
+        {
+            i2s_channel_disable(rx_chan_);
+        }
+
         if (thread_initialized_.load())
         {
             delete processing_thread_;
@@ -238,29 +304,39 @@ public:
             thread_initialized_.store(false);
         }
 
-        // Then shutdown the I2S channel
         if (rx_chan_)
         {
-            i2s_channel_disable(rx_chan_);
             i2s_del_channel(rx_chan_);
+            rx_chan_ = nullptr;
         }
 
         ESP_LOGI(TAG, "Microphone and FFT processing destroyed");
     }
 
-    // New getSpectrum implementation - just copies from pre-processed buffer
+    // Copy the lowest TFreqBins bands of the latest complete spectrum, returns its update count. Never blocks on
+    // the processing thread.
     template <std::size_t TFreqBins>
-    static void getSpectrum(std::array<float, TFreqBins>& spectrum)
+    static uint32_t getSpectrum(std::array<float, TFreqBins>& spectrum)
     {
         // Ensure we don't read more bins than we have data for
         static_assert(TFreqBins <= MAX_FREQ_BINS, "Requested frequency bins exceed maximum supported");
 
-        // Just copy data from the current active buffer - very fast operation
-        {
-            const uint8_t current_buffer = active_buffer_.load();
-            std::lock_guard lock(spectrum_mutex_);
-            std::memcpy(spectrum.data(), spectrum_buffer_[current_buffer].data(), sizeof(float) * TFreqBins);
-        }
+        Analysis latest;
+        const uint32_t update = analysis_.read(latest);
+        std::copy_n(latest.bands.begin(), TFreqBins, spectrum.begin());
+        return update;
+    }
+
+    // Copy the whole latest analysis at once, bands and features from the same hop
+    static uint32_t getAnalysis(Analysis& analysis)
+    {
+        return analysis_.read(analysis);
+    }
+
+    // Hops lost because the processing thread did not drain the queue in time
+    static uint32_t getOverruns()
+    {
+        return overruns_.load(std::memory_order_relaxed);
     }
 
     // Get the time taken for FFT processing (for diagnostics)
@@ -272,18 +348,27 @@ public:
     // Get update count for clients to detect new data
     static uint32_t getUpdateCount()
     {
-        return update_count_.load();
+        return analysis_.sequence();
     }
 };
 
 // Initialize static members
-std::mutex Microphone::read_mic_mutex_;
-std::mutex Microphone::spectrum_mutex_;
-std::array<int32_t, Microphone::BUFFER_SIZE> Microphone::buffer_;
+util::SpscQueue<Microphone::Hop, Microphone::HOP_QUEUE_DEPTH> Microphone::hops_;
+std::atomic<uint32_t> Microphone::overruns_{0};
+std::atomic<TaskHandle_t> Microphone::processing_task_{nullptr};
+util::SampleRing<int32_t, Microphone::BUFFER_SIZE> Microphone::window_;
 i2s_chan_handle_t Microphone::rx_chan_;
+Microphone::SpectrumAnalyzer Microphone::analyzer_;
+#if !CONFIG_TOTEM_MIC_SPECTRUM_GOERTZEL
+std::array<float, Microphone::BUFFER_SIZE / 2> Microphone::bins_;
+const util::Filterbank<Microphone::BUFFER_SIZE / 2, Microphone::MAX_FREQ_BINS> Microphone::filterbank_{
+    BAND_SCALE, SAMPLE_RATE, BAND_MIN_HZ, BAND_MAX_HZ
+};
+#endif
+util::AudioFeatureTracker<Microphone::MAX_FREQ_BINS> Microphone::feature_tracker_{
+    static_cast<float>(Microphone::SAMPLE_RATE) / Microphone::HOP_SIZE
+};
 ThreadManager* Microphone::processing_thread_ = nullptr;
 std::atomic<bool> Microphone::thread_initialized_(false);
-std::array<float, Microphone::MAX_FREQ_BINS> Microphone::spectrum_buffer_[2];
-std::atomic<uint8_t> Microphone::active_buffer_(0);
-std::atomic<uint32_t> Microphone::update_count_(0);
+util::SeqLock<Microphone::Analysis> Microphone::analysis_;
 std::atomic<uint32_t> Microphone::processing_time_us_(0);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "esp_attr.h"
+
+// How the panels of a chain are arranged in the virtual frame
+enum class PanelLayout : uint8_t
+{
+    // One row of panels, chain slot n covers virtual columns [n * width, (n + 1) * width)
+    HORIZONTAL,
+    // Rows of panels all mounted the same way up, each row chained left to right, top row first
+    TILED,
+    // Like TILED, but every odd row is chained right to left with its panels mounted upside down
+    SERPENTINE,
+};
+
+/**
+ * @brief Compile-time description of a HUB75 panel chain and its virtual-to-physical pixel mapping
+ * @tparam TPanelWidth Columns of a single panel
+ * @tparam TPanelHeight Rows of a single panel, 32 for 1/16 scan and 64 for 1/32 scan panels
+ * @tparam TChainLength Number of panels daisy-chained on the data lines
+ * @tparam TLayout Arrangement of the panels in the virtual frame
+ * @tparam TTileRows Rows of panels for TILED and SERPENTINE layouts
+ *
+ * Slot 0 is the first panel worth of pixels shifted out for a row, which ends up on the panel at the far end of
+ * the chain.
+ */
+template <uint16_t TPanelWidth, uint16_t TPanelHeight, uint8_t TChainLength = 1,
+          PanelLayout TLayout = PanelLayout::HORIZONTAL, uint8_t TTileRows = 1>
+struct PanelGeometry final
+{
+    static_assert(TPanelHeight == 32 || TPanelHeight == 64, "Only 1/16 and 1/32 scan panels are supported");
+    static_assert(TChainLength % TTileRows == 0, "Chain length must fill every tile row");
+    static_assert(TLayout != PanelLayout::HORIZONTAL || TTileRows == 1, "Horizontal layout has a single row");
+    static_assert(TPanelWidth * TChainLength * TPanelHeight <= UINT16_MAX, "Frame too large for 16-bit indices");
+
+    static constexpr uint16_t PANELS_PER_ROW = TChainLength / TTileRows;
+
+    static constexpr uint16_t WIDTH = TPanelWidth * PANELS_PER_ROW;
+    static constexpr uint16_t HEIGHT = TPanelHeight * TTileRows;
+    static constexpr uint16_t SIZE = WIDTH * HEIGHT;
+
+    // Each scan row drives one row of the top half and one of the bottom half of every panel at once
+    static constexpr uint8_t ROWS_PER_FRAME = TPanelHeight / 2;
+    static constexpr uint16_t PIXELS_PER_ROW = TPanelWidth * TChainLength;
+
+    // Virtual frame indices of the top and bottom half pixel shifted out together
+    struct PixelPair
+    {
+        uint16_t top;
+        uint16_t bot;
+    };
+
+    // Physical pixel pairs in shift-out order, ROWS_PER_FRAME rows of PIXELS_PER_ROW. Read for every pixel the
+    // encoder writes, so it is kept in DRAM like the encoder's tables rather than in flash.
+    static constexpr std::array<PixelPair, ROWS_PER_FRAME * PIXELS_PER_ROW> DRAM_ATTR MAP = []
+    {
+        std::array<PixelPair, ROWS_PER_FRAME * PIXELS_PER_ROW> map{};
+
+        const auto virtual_index = [](const uint16_t slot, uint16_t px, uint16_t py)
+        {
+            uint16_t tile_x = slot % PANELS_PER_ROW;
+            const uint16_t tile_y = slot / PANELS_PER_ROW;
+
+            if (TLayout == PanelLayout::SERPENTINE && tile_y % 2 == 1)
+            {
+                tile_x = PANELS_PER_ROW - 1 - tile_x;
+                px = TPanelWidth - 1 - px;
+                py = TPanelHeight - 1 - py;
+            }
+
+            const uint16_t vx = tile_x * TPanelWidth + px;
+            const uint16_t vy = tile_y * TPanelHeight + py;
+            return static_cast<uint16_t>(vy * WIDTH + vx);
+        };
+
+        for (uint16_t r = 0; r < ROWS_PER_FRAME; r++)
+        {
+            for (uint16_t c = 0; c < PIXELS_PER_ROW; c++)
+            {
+                const uint16_t slot = c / TPanelWidth;
+                const uint16_t px = c % TPanelWidth;
+                map[r * PIXELS_PER_ROW + c] = {
+                    virtual_index(slot, px, r),
+                    virtual_index(slot, px, r + ROWS_PER_FRAME),
+                };
+            }
+        }
+
+        return map;
+    }();
+};
@@ -1,8 +1,11 @@
 ﻿#pragma once
 
 #include <atomic>
+#include <cassert>
+#include <span>
 
 #include "esp_http_server.h"
+#include "FrameContext.hpp"
 #include "MatrixDriver.hpp"
 #include "util/Colors.hpp"
 
@@ -37,26 +40,42 @@ protected:
     {
     }
 
+    // Where render draws, bound by whoever composites the pattern and only valid for the frame it was bound for
+    std::span<uint32_t> buffer_;
+
 public:
-    std::array<uint32_t, MatrixDriver::SIZE> buffer_{};
+    virtual ~PatternBase() = default;
 
+    // Draw the next frame into the bound buffer, ctx is shared with every other pattern in the same frame
+    virtual void render(const FrameContext& ctx) = 0;
 
-    virtual ~PatternBase() = default;
+    // Advance the animation by one frame without drawing, for a pattern that is running but not visible, e.g. a
+    // faded out Playlist child. Patterns drawn only from ctx and their settings have nothing to advance.
+    virtual void tick(const FrameContext&)
+    {
+    }
 
-    virtual void render() = 0;
+    // The buffer the next clear() and render() draw into, patterns keep no pixels between frames
+    void bind(const std::span<uint32_t, MatrixDriver::SIZE> pixels)
+    {
+        buffer_ = pixels;
+    }
 
     void clear()
     {
+        assert(!buffer_.empty() && "bind() a buffer before drawing");
         std::ranges::fill(buffer_, 0);
     }
 
-    [[nodiscard]] const std::array<uint32_t, MatrixDriver::SIZE>& get_buf() const
+    virtual void from_json(const nlohmann::basic_json<>&)
     {
-        return buffer_;
     }
 
-    virtual void from_json(const nlohmann::basic_json<>& j)
+    // Heap the pattern holds beyond its own object, e.g. buffers it allocates, counted against a Playlist's memory
+    // ceiling
+    [[nodiscard]] virtual size_t footprint_bytes() const
     {
+        return 0;
     }
 
     [[nodiscard]] TickType_t get_render_tick() const
@@ -74,20 +93,26 @@ public:
         return name_;
     }
 
-    void draw_pixel_rgb(const uint8_t x, const uint8_t y, const uint8_t r, const uint8_t g, const uint8_t b)
+    void draw_pixel_rgb(const uint16_t x, const uint16_t y, const uint8_t r, const uint8_t g, const uint8_t b)
     {
         if (x >= MatrixDriver::WIDTH || y >= MatrixDriver::HEIGHT) return;
+        assert(!buffer_.empty() && "bind() a buffer before drawing");
         buffer_[y * MatrixDriver::WIDTH + x] = rgb_to_color_(r, g, b);
     }
 
-    void draw_pixel_hsv(const uint8_t x, const uint8_t y, const float h, const float s = 1.0f, const float v = 1.0f)
+    void fill_rgb(const uint8_t r, const uint8_t g, const uint8_t b)
+    {
+        std::ranges::fill(buffer_, rgb_to_color_(r, g, b));
+    }
+
+    void draw_pixel_hsv(const uint16_t x, const uint16_t y, const float h, const float s = 1.0f, const float v = 1.0f)
     {
         uint8_t r, g, b;
         util::colors::hsv_to_rgb(h, s, v, r, g, b);
         draw_pixel_rgb(x, y, r, g, b);
     }
 
-    void get_pixel_rgb(const uint8_t x, const uint8_t y, uint8_t& r_out, uint8_t& g_out, uint8_t& b_out) const
+    void get_pixel_rgb(const uint16_t x, const uint16_t y, uint8_t& r_out, uint8_t& g_out, uint8_t& b_out) const
     {
         if (x >= MatrixDriver::WIDTH || y >= MatrixDriver::HEIGHT)
         {
@@ -99,7 +124,7 @@ public:
         color_to_rgb_(color, r_out, g_out, b_out);
     }
 
-    void get_pixel_hsl(const uint8_t x, const uint8_t y, float& h_out, float& s_out, float& l_out) const
+    void get_pixel_hsl(const uint16_t x, const uint16_t y, float& h_out, float& s_out, float& l_out) const
     {
         if (x >= MatrixDriver::WIDTH || y >= MatrixDriver::HEIGHT)
         {
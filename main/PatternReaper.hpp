@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "PatternBase.hpp"
+#include "util/ThreadManager.hpp"
+
+/**
+ * @brief Destroys patterns the render thread is done with on a low priority thread
+ *
+ * A pattern's destructor can free large buffers, which would stall the frame it lands on. The render thread hands
+ * the last reference over in a box instead, both when Totem swaps the active pattern and when a Playlist releases a
+ * child whose cue has ended. Until start() has run, or when the queue is full, patterns are destroyed in place.
+ */
+class PatternReaper final
+{
+    static constexpr auto TAG = "PatternReaper";
+
+    static constexpr int THREAD_CORE = 0;
+    static constexpr size_t THREAD_STACK_SIZE = 4096;
+    static constexpr int THREAD_PRIORITY = 1;
+    static constexpr UBaseType_t QUEUE_LENGTH = 4;
+
+    static ThreadManager thread_;
+    static QueueHandle_t retired_;
+
+    static void threadFunc(const std::atomic<bool>& running)
+    {
+        while (running.load())
+        {
+            std::shared_ptr<PatternBase>* pattern = nullptr;
+            if (xQueueReceive(retired_, &pattern, pdMS_TO_TICKS(100)) == pdTRUE)
+            {
+                delete pattern;
+            }
+        }
+    }
+
+public:
+    PatternReaper() = delete;
+
+    static esp_err_t start()
+    {
+        if (retired_ != nullptr) return ESP_OK;
+
+        retired_ = xQueueCreate(QUEUE_LENGTH, sizeof(std::shared_ptr<PatternBase>*));
+        if (retired_ == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to create retired pattern queue");
+            return ESP_ERR_NO_MEM;
+        }
+
+        thread_.start(threadFunc);
+        return ESP_OK;
+    }
+
+    // Takes ownership of the box, the pattern goes with it unless someone else still holds a reference
+    static void retire(std::shared_ptr<PatternBase>* pattern)
+    {
+        if (retired_ == nullptr || xQueueSend(retired_, &pattern, 0) != pdTRUE)
+        {
+            if (retired_ != nullptr) ESP_LOGW(TAG, "Retired pattern queue full, destroying on the calling thread");
+            delete pattern;
+        }
+    }
+
+    // Boxes the reference, the box is a few bytes where the pattern may hold kilobytes
+    static void retire(std::shared_ptr<PatternBase>&& pattern)
+    {
+        if (pattern) retire(new std::shared_ptr(std::move(pattern)));
+    }
+};
+
+ThreadManager PatternReaper::thread_("totem_reaper_thread", THREAD_CORE, THREAD_STACK_SIZE, THREAD_PRIORITY);
+QueueHandle_t PatternReaper::retired_ = nullptr;
@@ -17,13 +17,12 @@ class PatternRegistry final
 public:
     PatternRegistry() = delete;
 
+    // Registered under TPattern::NAME, nothing is constructed until the pattern is created
     template <typename TPattern>
     static void add_pattern()
     {
-        auto temp_instance = std::make_shared<TPattern>();
-        const std::string name = temp_instance->get_name();
-        pattern_factories_[name] = [] { return std::make_shared<TPattern>(); };
-        ESP_LOGI(TAG, "Pattern registered: %s", name.c_str());
+        pattern_factories_[TPattern::NAME] = [] { return std::make_shared<TPattern>(); };
+        ESP_LOGI(TAG, "Pattern registered: %s", TPattern::NAME);
     }
 
     static std::shared_ptr<PatternBase> create_pattern(const std::string& name)
@@ -1,30 +1,160 @@
 ﻿#pragma once
 
+#include "FramePool.hpp"
+#include "Metrics.hpp"
 #include "PatternBase.hpp"
+#include "PatternReaper.hpp"
+#include "util/Blend.hpp"
+#include "util/Timeline.hpp"
+#include <functional>
 #include <vector>
 #include <memory>
-#include <chrono>
 
 class Playlist : public PatternBase
 {
+    static constexpr auto TAG = "Playlist";
+
     // Structure to hold pattern timing information
     struct PatternInfo
     {
-        std::shared_ptr<PatternBase> pattern;
+        std::function<std::shared_ptr<PatternBase>()> create; // Builds the pattern with the arguments it was added with
+        size_t object_bytes; // sizeof the pattern
+        // object_bytes plus the pattern's footprint_bytes() when it was last built, only object_bytes before that
+        size_t size_bytes;
         uint32_t start_time_ms; // Start time in milliseconds
         uint32_t end_time_ms; // End time in milliseconds
         uint32_t fade_ms; // Fade in/out time in milliseconds (optional)
+        std::shared_ptr<PatternBase> pattern; // Only while the cue or its prefetch lead covers the current time
     };
 
     std::vector<PatternInfo> timed_patterns;
 
     uint32_t total_time_ms_{60000}; // Default to 60 seconds
     uint32_t current_time_ms_{0}; // Current position in the playlist
-    std::chrono::time_point<std::chrono::steady_clock> last_update_time_;
-    bool time_initialized_{false};
+    uint32_t pending_us_{0}; // Frame time not yet added to current_time_ms_
+
+    // Cues covering current_time_ms_, and the same cues starting prefetch_ms_ early for the ones to keep built.
+    // Rebuilt on the first frame after the cues, the length or the lead change.
+    util::Timeline timeline_;
+    util::Timeline resident_timeline_;
+    bool timeline_dirty_{true};
+
+    uint32_t prefetch_ms_{CONFIG_TOTEM_PLAYLIST_PREFETCH_MS};
+    size_t memory_ceiling_bytes_{CONFIG_TOTEM_PLAYLIST_MEMORY_KB * 1024};
+    size_t resident_bytes_{0};
+    std::vector<uint32_t> loaded_; // Cues with a pattern built, sorted
+
+    // Per-frame blend state for the active cues, sized with timed_patterns so rendering never allocates
+    std::vector<float> weights_;
+    std::vector<uint16_t> fixed_weights_;
+    std::vector<const uint32_t*> blend_sources_;
+    std::vector<FramePool::Lease> leases_; // Children's frames, held until they are blended
+    std::vector<uint16_t> blend_weights_;
+
+    void add_timed_pattern(PatternInfo info)
+    {
+        timed_patterns.push_back(std::move(info));
+        weights_.resize(timed_patterns.size());
+        fixed_weights_.resize(timed_patterns.size());
+        blend_sources_.reserve(timed_patterns.size());
+        leases_.reserve(timed_patterns.size());
+        blend_weights_.reserve(timed_patterns.size());
+        loaded_.reserve(timed_patterns.size());
+        timeline_dirty_ = true;
+    }
+
+    // The times each cue can have weight, as in calculate_pattern_weight: ends are inclusive, and a cue ending with
+    // the playlist also fades out over the start of the next loop
+    void compile_timeline()
+    {
+        timeline_.clear();
+        resident_timeline_.clear();
+        const uint32_t lead = std::min(prefetch_ms_, total_time_ms_);
+
+        for (uint32_t j = 0; j < timed_patterns.size(); j++)
+        {
+            const auto add = [&](const uint32_t begin_ms, const uint32_t end_ms)
+            {
+                timeline_.add(j, begin_ms, end_ms);
+                resident_timeline_.add(j, begin_ms >= lead ? begin_ms - lead : 0, end_ms);
+                if (begin_ms < lead) resident_timeline_.add(j, total_time_ms_ - (lead - begin_ms), total_time_ms_ + 1);
+            };
+
+            const PatternInfo& info = timed_patterns[j];
+            if (info.end_time_ms < info.start_time_ms)
+            {
+                add(info.start_time_ms, total_time_ms_ + 1);
+                add(0, info.end_time_ms + 1);
+            }
+            else
+            {
+                add(info.start_time_ms, info.end_time_ms + 1);
+                if (info.end_time_ms == total_time_ms_ && info.fade_ms > 0) add(0, info.fade_ms);
+            }
+        }
+
+        timeline_.compile();
+        resident_timeline_.compile();
+        timeline_.seek(current_time_ms_);
+        resident_timeline_.seek(current_time_ms_);
+        timeline_dirty_ = false;
+    }
+
+    void load(const uint32_t j)
+    {
+        PatternInfo& info = timed_patterns[j];
+        info.pattern = info.create();
+        info.size_bytes = info.object_bytes + info.pattern->footprint_bytes();
+        resident_bytes_ += info.size_bytes;
+        loaded_.insert(std::ranges::lower_bound(loaded_, j), j);
+    }
+
+    // Drop the patterns whose cue and lead have passed, build the ones that are visible now, and within the memory
+    // ceiling one of the upcoming ones per frame so that construction is spread ahead of the fades. An upcoming
+    // pattern is judged by its size when it was last built, so one never built yet only by its object size.
+    void update_residency()
+    {
+        const std::span<const uint32_t> resident = resident_timeline_.active();
+
+        size_t r = 0;
+        auto kept = loaded_.begin();
+        for (const uint32_t j : loaded_)
+        {
+            while (r < resident.size() && resident[r] < j) r++;
+            if (r < resident.size() && resident[r] == j)
+            {
+                *kept++ = j;
+                continue;
+            }
+
+            // Destroyed off the render thread, its memory comes back shortly after it stops being counted
+            PatternReaper::retire(std::move(timed_patterns[j].pattern));
+            resident_bytes_ -= timed_patterns[j].size_bytes;
+        }
+        loaded_.erase(kept, loaded_.end());
+
+        for (const uint32_t j : timeline_.active())
+        {
+            if (timed_patterns[j].pattern) continue;
+            if (resident_bytes_ + timed_patterns[j].size_bytes > memory_ceiling_bytes_)
+            {
+                ESP_LOGW(TAG, "%s: cue %lu is visible, building it over the %zu byte ceiling", get_name().c_str(),
+                         static_cast<unsigned long>(j), memory_ceiling_bytes_);
+            }
+            load(j);
+        }
+
+        for (const uint32_t j : resident)
+        {
+            if (timed_patterns[j].pattern) continue;
+            if (resident_bytes_ + timed_patterns[j].size_bytes > memory_ceiling_bytes_) continue;
+            load(j);
+            break;
+        }
+    }
 
 protected:
-    // Method with timing parameters in milliseconds
+    // Method with timing parameters in milliseconds. The pattern is built from the arguments shortly before its cue.
     template <typename TPattern, typename... Args>
     void add_pattern(uint32_t start_time_ms, uint32_t end_time_ms, uint32_t fade_ms = 0, Args&&... args)
     {
@@ -35,8 +165,10 @@ protected:
         // Allowing end_time to be less than start_time to indicate a pattern that wraps around
         // from the end of the playlist back to the beginning
 
-        auto pattern = std::make_shared<TPattern>(std::forward<Args>(args)...);
-        timed_patterns.push_back({pattern, start_time_ms, end_time_ms, fade_ms});
+        add_timed_pattern({
+            [... args = std::forward<Args>(args)] { return std::make_shared<TPattern>(args...); },
+            sizeof(TPattern), sizeof(TPattern), start_time_ms, end_time_ms, fade_ms, nullptr
+        });
     }
 
     // Add a pattern that spans from start_time to the end of the playlist,
@@ -48,48 +180,58 @@ protected:
         start_time_ms = std::min(start_time_ms, total_time_ms_);
         end_time_ms = std::min(end_time_ms, total_time_ms_);
 
-        auto pattern = std::make_shared<TPattern>(std::forward<Args>(args)...);
-
         // For clarity in the implementation, we'll treat this as a special case
         // where end_time < start_time
-        timed_patterns.push_back({pattern, start_time_ms, end_time_ms, fade_ms});
+        add_timed_pattern({
+            [... args = std::forward<Args>(args)] { return std::make_shared<TPattern>(args...); },
+            sizeof(TPattern), sizeof(TPattern), start_time_ms, end_time_ms, fade_ms, nullptr
+        });
     }
 
     void set_total_time(const uint32_t time_ms)
     {
         total_time_ms_ = time_ms;
+        timeline_dirty_ = true;
     }
 
     void set_start_time(const uint32_t start_time_ms)
     {
         // Ensure start time doesn't exceed total time
         current_time_ms_ = std::min(start_time_ms, total_time_ms_);
-        
-        // We need to reset the time initialization to avoid a big time jump
-        // on the first update_time() call
-        time_initialized_ = false;
+        pending_us_ = 0;
+        timeline_.seek(current_time_ms_);
+        resident_timeline_.seek(current_time_ms_);
     }
-    
-    // Update current playlist time
-    void update_time()
+
+    // How long before its cue a pattern is built
+    void set_prefetch_time(const uint32_t time_ms)
     {
-        const auto now = std::chrono::steady_clock::now();
+        prefetch_ms_ = time_ms;
+        timeline_dirty_ = true;
+    }
 
-        if (!time_initialized_)
-        {
-            last_update_time_ = now;
-            time_initialized_ = true;
-            return;
-        }
+    // Patterns are only built ahead of their cue while they fit under this, visible ones are always built
+    void set_memory_ceiling(const size_t bytes)
+    {
+        memory_ceiling_bytes_ = bytes;
+    }
 
-        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update_time_).count();
-        last_update_time_ = now;
+    // Advance the playlist by the frame's dt, keeping the sub-millisecond remainder for the next frame
+    void update_time(const uint32_t dt_us)
+    {
+        pending_us_ += dt_us;
+        current_time_ms_ += pending_us_ / 1000;
+        pending_us_ %= 1000;
 
-        current_time_ms_ += static_cast<uint32_t>(elapsed);
         if (current_time_ms_ >= total_time_ms_)
         {
             current_time_ms_ %= total_time_ms_;
         }
+
+        if (timeline_dirty_) compile_timeline();
+        timeline_.advance(current_time_ms_);
+        resident_timeline_.advance(current_time_ms_);
+        update_residency();
     }
 
     // Calculate pattern weight based on current time and fade settings
@@ -193,68 +335,96 @@ protected:
     }
 
 public:
-    explicit Playlist(std::string name) : PatternBase(std::move(name)),
-                                          last_update_time_(std::chrono::steady_clock::now())
+    explicit Playlist(std::string name) : PatternBase(std::move(name))
     {
     }
 
-    void render() override
+    // Bytes of the children built right now, see PatternInfo::size_bytes
+    [[nodiscard]] size_t get_resident_bytes() const
+    {
+        return resident_bytes_;
+    }
+
+    // The cue table and the children built right now, so a playlist nested in another one is counted whole
+    [[nodiscard]] size_t footprint_bytes() const override
+    {
+        return timed_patterns.capacity() * sizeof(PatternInfo) + resident_bytes_;
+    }
+
+    void render(const FrameContext& ctx) override
     {
         // Update current time in the playlist
-        update_time();
+        update_time(ctx.dt_us);
 
-        // If using timed patterns
-        if (!timed_patterns.empty())
-        {
-            float total_weight = 0.0f;
-            std::vector<float> weights;
-            weights.reserve(timed_patterns.size());
+        // Only the cues covering the current time are touched. Weights first, so that only the patterns that show up
+        // in the blend are rendered.
+        const std::span<const uint32_t> active = timeline_.active();
+        if (active.empty()) return;
 
-            // Calculate and collect weights for all patterns
-            for (const auto& pattern_info : timed_patterns)
-            {
-                pattern_info.pattern->clear();
-                pattern_info.pattern->render();
+        for (size_t k = 0; k < active.size(); k++)
+        {
+            weights_[k] = calculate_pattern_weight(timed_patterns[active[k]]);
+        }
 
-                float weight = calculate_pattern_weight(pattern_info);
-                weights.push_back(weight);
-                total_weight += weight;
-            }
+        // Normalized once per frame, the per-pixel blend is integer only. If no active patterns, tick them all.
+        const bool any_visible = util::blend::normalize(std::span(weights_).first(active.size()),
+                                                        std::span(fixed_weights_).first(active.size()));
 
-            // If no active patterns, return
-            if (total_weight <= 0.0f) return;
+        // A lone visible child draws straight into this playlist's frame, several each lease one from the pool
+        const auto visible = std::ranges::count_if(std::span(fixed_weights_).first(active.size()),
+                                                   [](const uint16_t w) { return w != 0; });
 
-            // Blend patterns
-            for (size_t i = 0; i < MatrixDriver::SIZE; i++)
+        blend_sources_.clear();
+        blend_weights_.clear();
+        for (size_t k = 0; k < active.size(); k++)
+        {
+            PatternBase& pattern = *timed_patterns[active[k]].pattern;
+            if (!any_visible || fixed_weights_[k] == 0)
             {
-                float r_sum = 0.0f;
-                float g_sum = 0.0f;
-                float b_sum = 0.0f;
-
-                for (size_t j = 0; j < timed_patterns.size(); j++)
-                {
-                    const float weight = weights[j];
-                    if (weight <= 0.0f) continue;
+                pattern.tick(ctx);
+                continue;
+            }
 
-                    const PatternBase* source = timed_patterns[j].pattern.get();
-                    const uint32_t color = source->buffer_[i];
+            if (visible == 1)
+            {
+                pattern.bind(buffer_.first<MatrixDriver::SIZE>());
+                pattern.clear();
+                pattern.render(ctx);
+                continue;
+            }
 
-                    const float r = static_cast<float>((color >> 16) & 0xFF);
-                    const float g = static_cast<float>((color >> 8) & 0xFF);
-                    const float b = static_cast<float>(color & 0xFF);
+            // With the pool exhausted the child sits this frame out, the blend is just darker by its weight
+            FramePool::Lease lease = FramePool::acquire();
+            if (!lease)
+            {
+                pattern.tick(ctx);
+                continue;
+            }
 
-                    const float norm_weight = weight / total_weight;
-                    r_sum += r * norm_weight;
-                    g_sum += g * norm_weight;
-                    b_sum += b * norm_weight;
-                }
+            pattern.bind(lease.pixels());
+            pattern.clear();
+            pattern.render(ctx);
+            blend_sources_.push_back(lease.pixels().data());
+            blend_weights_.push_back(fixed_weights_[k]);
+            leases_.push_back(std::move(lease));
+        }
+        if (visible <= 1) return;
 
-                const uint32_t r = static_cast<uint32_t>(r_sum + 0.5f);
-                const uint32_t g = static_cast<uint32_t>(g_sum + 0.5f);
-                const uint32_t b = static_cast<uint32_t>(b_sum + 0.5f);
+        // Blend patterns
+        {
+            TOTEM_METRICS_SCOPE(MetricStage::BLEND);
+            util::blend::mix(blend_sources_, blend_weights_, buffer_.data(), MatrixDriver::SIZE);
+        }
+        leases_.clear();
+    }
 
-                buffer_[i] = (r << 16) | (g << 8) | b;
-            }
+    // A hidden playlist keeps its place in time and its active children's animations
+    void tick(const FrameContext& ctx) override
+    {
+        update_time(ctx.dt_us);
+        for (const uint32_t j : timeline_.active())
+        {
+            timed_patterns[j].pattern->tick(ctx);
         }
     }
 };
@@ -6,6 +6,9 @@
 #include "esp_chip_info.h"
 #include <nlohmann/json.hpp>
 
+#include "FramePool.hpp"
+#include "Metrics.hpp"
+#include "Microphone.hpp"
 #include "PatternRegistry.hpp"
 
 class RestServer final
@@ -57,11 +60,29 @@ public:
             return err;
         }
 
+#if CONFIG_TOTEM_METRICS
+        err = reg_metrics_endpoint();
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to register metrics endpoint");
+            return err;
+        }
+#endif
+
         ESP_LOGI(TAG, "Running");
         return ESP_OK;
     }
 
 private:
+    // The server task belongs to esp_http_server, so it registers for stack tracking from the first request it serves
+    static void track_httpd_task()
+    {
+#if CONFIG_TOTEM_METRICS
+        static std::atomic<bool> registered{false};
+        if (!registered.exchange(true)) Metrics::registerTask("httpd");
+#endif
+    }
+
     [[nodiscard]] static esp_err_t reg_sys_info_endpoint()
     {
         constexpr httpd_uri_t system_info_get_uri = {
@@ -69,12 +90,27 @@ private:
             .method = HTTP_GET,
             .handler = [](httpd_req_t* req)
             {
+                track_httpd_task();
+                TOTEM_METRICS_SCOPE(MetricStage::HTTP);
                 httpd_resp_set_type(req, "application/json");
                 nlohmann::json root;
                 root["version"] = IDF_VER;
                 esp_chip_info_t chip_info;
                 esp_chip_info(&chip_info);
                 root["cores"] = chip_info.cores;
+                root["missed_frames"] = Totem::get_missed_frames();
+                root["missed_renders"] = Totem::get_missed_renders();
+                const auto timing = Totem::get_stage_timing();
+                root["render_us"] = timing.render_us;
+                root["encode_us"] = timing.encode_us;
+                root["fps"] = timing.fps;
+                root["audio_latency_us"] = timing.audio_latency_us;
+                root["mic_overruns"] = Microphone::getOverruns();
+                const auto pool = FramePool::getOccupancy();
+                root["frame_pool"] = {
+                    {"capacity", pool.capacity}, {"in_use", pool.in_use}, {"peak", pool.peak},
+                    {"exhausted", pool.exhausted}
+                };
                 const std::string sys_info = root.dump();
                 httpd_resp_sendstr(req, sys_info.c_str());
                 return ESP_OK;
@@ -91,10 +127,23 @@ private:
             .method = HTTP_POST,
             .handler = [](httpd_req_t* req)
             {
+                track_httpd_task();
+                TOTEM_METRICS_SCOPE(MetricStage::HTTP);
                 auto body_or_error = util::http::get_req_body(req, TAG);
                 if (!body_or_error) return body_or_error.error();
                 const auto j = nlohmann::json::parse(body_or_error.value());
-                Totem::set_brightness(j.value("brightness", 255));
+
+                const auto ramp = j.value("ramp_frames", nlohmann::json(0));
+                if (!ramp.is_number_integer())
+                {
+                    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "ramp_frames must be an integer");
+                    return ESP_FAIL;
+                }
+                // Non-negative values parse as unsigned, anything else is below zero
+                const uint16_t ramp_frames = ramp.is_number_unsigned()
+                                                 ? std::min<uint64_t>(ramp.get<uint64_t>(), UINT16_MAX)
+                                                 : 0;
+                Totem::set_brightness(j.value("brightness", 255), ramp_frames);
                 httpd_resp_sendstr(req, "Brightness set successfully");
                 return ESP_OK;
             },
@@ -111,6 +160,8 @@ private:
             .method = HTTP_GET,
             .handler = [](httpd_req_t* req)
             {
+                track_httpd_task();
+                TOTEM_METRICS_SCOPE(MetricStage::HTTP);
                 httpd_resp_set_type(req, "application/json");
                 nlohmann::json response;
                 response["patterns"] = PatternRegistry::get_pattern_names();
@@ -132,6 +183,8 @@ private:
             .method = HTTP_POST,
             .handler = [](httpd_req_t* req)
             {
+                track_httpd_task();
+                TOTEM_METRICS_SCOPE(MetricStage::HTTP);
                 // First, get the request body
                 auto body_or_error = util::http::get_req_body(req, TAG);
                 if (!body_or_error) return body_or_error.error();
@@ -180,4 +233,35 @@ private:
 
         return httpd_register_uri_handler(server_handle_, &pattern_post_uri);
     }
+
+#if CONFIG_TOTEM_METRICS
+    [[nodiscard]] static esp_err_t reg_metrics_endpoint()
+    {
+        // GET endpoint for stage timings and stack high-water marks, "?reset" starts a new measurement window
+        constexpr httpd_uri_t metrics_get_uri = {
+            .uri = "/api/metrics",
+            .method = HTTP_GET,
+            .handler = [](httpd_req_t* req)
+            {
+                track_httpd_task();
+                httpd_resp_set_type(req, "application/json");
+                const std::string metrics = Metrics::toJson().dump();
+                httpd_resp_sendstr(req, metrics.c_str());
+
+                if (httpd_req_get_url_query_len(req) > 0)
+                {
+                    char query[16];
+                    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                        std::string_view(query).starts_with("reset"))
+                    {
+                        Metrics::reset();
+                    }
+                }
+                return ESP_OK;
+            },
+            .user_ctx = nullptr,
+        };
+        return httpd_register_uri_handler(server_handle_, &metrics_get_uri);
+    }
+#endif
 };
@@ -1,22 +1,56 @@
 ﻿#pragma once
 
 #include <memory>
-#include <mutex>
 
 #include "nlohmann/json.hpp"
+#include "FrameContext.hpp"
+#include "FramePool.hpp"
 #include "PatternBase.hpp"
+#include "PatternReaper.hpp"
+#include "Metrics.hpp"
+#include "Microphone.hpp"
 #include "PatternRegistry.hpp"
 #include "util/Http.hpp"
 #include "util/ThreadManager.hpp"
+#include "util/TripleBuffer.hpp"
 
 class Totem final
 {
     static constexpr auto TAG = "Totem";
 
+    // Cadence of panel uploads, patterns render at their own tick on top of it
+    static constexpr TickType_t FRAME_TICK = PatternBase::DEFAULT_RENDER_TICK;
+    // Bounds how long the encoder sleeps between checks of its running flag
+    static constexpr TickType_t ENCODE_WAIT = pdMS_TO_TICKS(100);
+
+    static constexpr int ENCODE_THREAD_CORE = 0;
+    static constexpr size_t ENCODE_THREAD_STACK_SIZE = 4096;
+    static constexpr int ENCODE_THREAD_PRIORITY = 6; // Above the mic FFT, encoding is short and deadline bound
+
+    struct Frame
+    {
+        std::array<uint32_t, MatrixDriver::SIZE> pixels;
+        int64_t audio_us; // Capture time of the newest audio the pattern could see, 0 without a microphone
+    };
+
     static std::atomic<uint8_t> brightness_;
+    static std::atomic<uint16_t> brightness_ramp_frames_;
+    static std::atomic<bool> brightness_changed_;
+    static std::atomic<uint32_t> missed_frames_;
+    static std::atomic<uint32_t> missed_renders_;
     static ThreadManager render_thread_;
-    static std::mutex state_mutex_;
+    static ThreadManager encode_thread_;
+    static util::TripleBuffer<Frame> frames_;
+    static SemaphoreHandle_t frame_ready_;
+    static std::atomic<uint32_t> render_time_us_;
+    static std::atomic<uint32_t> encode_time_us_;
+    static std::atomic<uint32_t> audio_latency_us_;
+    static std::atomic<uint32_t> fps_;
+    // Published by set_pattern, taken by the render thread at the next frame boundary
+    static std::atomic<std::shared_ptr<PatternBase>*> pending_pattern_;
+    // Owned by the render thread
     static std::shared_ptr<PatternBase> active_pattern_;
+    static FrameContext context_;
 
 public:
     Totem() = delete;
@@ -25,39 +59,45 @@ public:
     {
         ESP_LOGI(TAG, "Starting...");
 
-        render_thread_.start([](const std::atomic<bool>& running)
+        if (const esp_err_t err = FramePool::init(); err != ESP_OK)
         {
-            while (running.load())
-            {
-                {
-                    std::lock_guard lock(state_mutex_);
-                    if (active_pattern_)
-                    {
-                        active_pattern_->clear();
-                        active_pattern_->render();
-                        MatrixDriver::loadFromBuffer(active_pattern_->get_buf());
-                    }
-                }
-                vTaskDelay(pdMS_TO_TICKS(16));
-            }
-        });
+            return err;
+        }
+
+        frame_ready_ = xSemaphoreCreateBinary();
+        if (frame_ready_ == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to create frame semaphore");
+            return ESP_ERR_NO_MEM;
+        }
+
+        // Retired patterns are destroyed there so a large destructor never lands on the render thread
+        if (const esp_err_t err = PatternReaper::start(); err != ESP_OK)
+        {
+            return err;
+        }
+
+        // Pattern N+1 renders on core 1 while frame N is bit-plane encoded on core 0
+        encode_thread_.start(encodeThreadFunc);
+        render_thread_.start(renderThreadFunc);
 
         ESP_LOGI(TAG, "Running");
         return ESP_OK;
     }
 
+    // Never blocks on the render loop, the pattern is swapped in at the next frame boundary. If several are set
+    // within one frame only the last is shown.
     static void set_pattern(const std::shared_ptr<PatternBase>& pattern)
     {
-        std::lock_guard lock(state_mutex_);
-        active_pattern_ = pattern;
+        const auto prev = pending_pattern_.exchange(new std::shared_ptr(pattern), std::memory_order_acq_rel);
+        delete prev;
     }
 
+    // Constructs the pattern on the calling thread, not the render thread
     template <typename TPattern, typename... TArgs>
     static void set_pattern(TArgs&&... args)
     {
-        std::lock_guard lock(state_mutex_);
-        auto state = std::make_shared<TPattern>(std::forward<TArgs>(args)...);
-        active_pattern_ = state;
+        set_pattern(std::make_shared<TPattern>(std::forward<TArgs>(args)...));
     }
 
     [[nodiscard]] static esp_err_t set_pattern(const std::string& pattern_name)
@@ -72,15 +112,252 @@ public:
         return ESP_OK;
     }
 
-    static void set_brightness(const uint8_t brightness)
+    // Picked up by the render loop at the next frame, optionally fading there over ramp_frames frames. Never
+    // blocks, so it can be called as often as a UI slider produces values.
+    static void set_brightness(const uint8_t brightness, const uint16_t ramp_frames = 0)
     {
-        std::lock_guard lock(state_mutex_);
+        brightness_ramp_frames_.store(ramp_frames);
         brightness_.store(brightness);
+        brightness_changed_.store(true);
+    }
+
+    [[nodiscard]] static uint8_t get_brightness()
+    {
+        return brightness_.load();
+    }
+
+    // Panel frames that took longer than FRAME_TICK
+    [[nodiscard]] static uint32_t get_missed_frames()
+    {
+        return missed_frames_.load();
+    }
+
+    // Pattern renders dropped because the loop fell more than a render tick behind
+    [[nodiscard]] static uint32_t get_missed_renders()
+    {
+        return missed_renders_.load();
+    }
+
+    // Pipeline stage timings, averaged over recent frames
+    struct StageTiming
+    {
+        uint32_t render_us;
+        uint32_t encode_us;
+        uint32_t fps;
+        uint32_t audio_latency_us; // From the capture of the newest audio a frame could react to until it is shown
+    };
+
+    [[nodiscard]] static StageTiming get_stage_timing()
+    {
+        return {render_time_us_.load(), encode_time_us_.load(), fps_.load(), audio_latency_us_.load()};
+    }
+
+private:
+    // Exponential moving average over roughly the last 8 samples
+    static void recordTime(std::atomic<uint32_t>& average, const int64_t start_us)
+    {
+        const auto sample = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+        const uint32_t prev = average.load(std::memory_order_relaxed);
+        average.store(prev - (prev >> 3) + (sample >> 3), std::memory_order_relaxed);
+    }
+
+    // Core 1: runs patterns on their render ticks and publishes finished frames to the encoder
+    static void renderThreadFunc(const std::atomic<bool>& running)
+    {
+        BrightnessRamp ramp{};
+        ramp.jump(brightness_.load());
+
+        TickType_t next_render = 0;
+        TickType_t last_wake = xTaskGetTickCount();
+        int64_t last_render_us = 0; // 0 until the active pattern has rendered once
+
+        while (running.load())
+        {
+            // Brightness only changes between frames, the driver patches the OE bits of the back buffer
+            if (brightness_changed_.exchange(false))
+            {
+                ramp.start(brightness_.load(), brightness_ramp_frames_.load());
+            }
+
+            const uint8_t brightness = ramp.step();
+            bool wake_encoder = brightness != MatrixDriver::getBrightness();
+            MatrixDriver::setBrightness(brightness);
+
+            if (const auto pending = pending_pattern_.exchange(nullptr, std::memory_order_acq_rel))
+            {
+                // The box keeps the old pattern alive until the reaper drops it
+                std::swap(active_pattern_, *pending);
+                PatternReaper::retire(pending);
+
+                // A new pattern renders right away, then on its own deadlines
+                next_render = xTaskGetTickCount();
+                last_render_us = 0;
+            }
+
+            if (active_pattern_)
+            {
+                const TickType_t now = xTaskGetTickCount();
+
+                if (static_cast<int32_t>(now - next_render) >= 0)
+                {
+                    const int64_t start_us = esp_timer_get_time();
+
+                    // One timestamp and one audio snapshot for everything the pattern renders this frame
+                    context_.time_us = start_us;
+                    context_.dt_us = last_render_us != 0 ? static_cast<uint32_t>(start_us - last_render_us) : 0;
+                    context_.audio_update = Microphone::getAnalysis(context_.audio);
+                    last_render_us = start_us;
+
+                    Frame& frame = frames_.write_slot();
+                    frame.audio_us = context_.audio.captured_us;
+
+                    // The pattern draws straight into the frame the encoder picks up next
+                    {
+                        TOTEM_METRICS_SCOPE(MetricStage::RENDER);
+                        active_pattern_->bind(frame.pixels);
+                        active_pattern_->clear();
+                        active_pattern_->render(context_);
+                    }
+                    context_.index++;
+                    frames_.publish();
+                    recordTime(render_time_us_, start_us);
+                    wake_encoder = true;
+
+                    next_render += active_pattern_->get_render_tick();
+                    if (static_cast<int32_t>(now - next_render) >= 0)
+                    {
+                        // More than a whole tick behind, skip the lost renders instead of bursting
+                        missed_renders_.fetch_add(1 + (now - next_render) / active_pattern_->get_render_tick());
+                        next_render = now + active_pattern_->get_render_tick();
+                    }
+                }
+            }
+
+            // A brightness step alone re-encodes the current frame, its unchanged rows are skipped
+            if (wake_encoder)
+            {
+                xSemaphoreGive(frame_ready_);
+            }
+
+            if (xTaskDelayUntil(&last_wake, FRAME_TICK) == pdFALSE)
+            {
+                // The frame overran its slot, restart the cadence from now rather than catching up
+                missed_frames_.fetch_add(1);
+                last_wake = xTaskGetTickCount();
+            }
+        }
+    }
+
+    // Core 0: encodes the newest published frame into the back DMA set and flips it in
+    static void encodeThreadFunc(const std::atomic<bool>& running)
+    {
+        uint32_t frames = 0;
+        int64_t window_start_us = esp_timer_get_time();
+
+        while (running.load())
+        {
+            if (xSemaphoreTake(frame_ready_, ENCODE_WAIT) != pdTRUE)
+            {
+                continue;
+            }
+
+            const bool fresh = frames_.consume();
+            const Frame& frame = frames_.read_slot();
+
+            // The back set is busy until the previous flip is picked up, that wait is not part of the encode
+            if (!MatrixDriver::waitForFlip())
+            {
+                continue;
+            }
+
+            const int64_t start_us = esp_timer_get_time();
+            {
+                TOTEM_METRICS_SCOPE(MetricStage::ENCODE);
+                if (MatrixDriver::writeBackBuffer(frame.pixels.data()))
+                {
+                    MatrixDriver::flipBuffers();
+                }
+            }
+            recordTime(encode_time_us_, start_us);
+
+            // The frame is lit once the DMA picks up the flip, waiting here costs nothing as the next encode
+            // would wait for it anyway
+            if (fresh && frame.audio_us != 0 && MatrixDriver::waitForFlip())
+            {
+                recordTime(audio_latency_us_, frame.audio_us);
+#if CONFIG_TOTEM_METRICS
+                Metrics::recordUs(MetricStage::AUDIO_TO_PHOTON, esp_timer_get_time() - frame.audio_us);
+#endif
+            }
+
+            frames++;
+            if (const int64_t now_us = esp_timer_get_time(); now_us - window_start_us >= 1000000)
+            {
+                fps_.store(frames * 1000000ULL / (now_us - window_start_us));
+                frames = 0;
+                window_start_us = now_us;
+            }
+        }
     }
+
+    // Linear fade in 8.8 fixed point, owned by the render thread
+    struct BrightnessRamp
+    {
+        int32_t current = 0;
+        int32_t delta = 0;
+        uint16_t frames_left = 0;
+        uint8_t target = 0;
+
+        void jump(const uint8_t brightness)
+        {
+            current = brightness << 8;
+            target = brightness;
+            frames_left = 0;
+        }
+
+        void start(const uint8_t brightness, const uint16_t frames)
+        {
+            if (frames == 0)
+            {
+                jump(brightness);
+                return;
+            }
+
+            target = brightness;
+            frames_left = frames;
+            delta = ((brightness << 8) - current) / frames;
+        }
+
+        uint8_t step()
+        {
+            if (frames_left > 0 && --frames_left > 0)
+            {
+                current += delta;
+            }
+            else
+            {
+                current = target << 8;
+            }
+            return static_cast<uint8_t>((current + 0x80) >> 8);
+        }
+    };
 };
 
 
 std::atomic<uint8_t> Totem::brightness_{255};
+std::atomic<uint16_t> Totem::brightness_ramp_frames_{0};
+std::atomic<bool> Totem::brightness_changed_{false};
+std::atomic<uint32_t> Totem::missed_frames_{0};
+std::atomic<uint32_t> Totem::missed_renders_{0};
 ThreadManager Totem::render_thread_("totem_render_thread", 1, 8192, configMAX_PRIORITIES);
-std::mutex Totem::state_mutex_;
+ThreadManager Totem::encode_thread_("totem_encode_thread", ENCODE_THREAD_CORE, ENCODE_THREAD_STACK_SIZE,
+                                    ENCODE_THREAD_PRIORITY);
+util::TripleBuffer<Totem::Frame> Totem::frames_;
+SemaphoreHandle_t Totem::frame_ready_;
+std::atomic<uint32_t> Totem::render_time_us_{0};
+std::atomic<uint32_t> Totem::encode_time_us_{0};
+std::atomic<uint32_t> Totem::audio_latency_us_{0};
+std::atomic<uint32_t> Totem::fps_{0};
+std::atomic<std::shared_ptr<PatternBase>*> Totem::pending_pattern_{nullptr};
 std::shared_ptr<PatternBase> Totem::active_pattern_;
+FrameContext Totem::context_{};
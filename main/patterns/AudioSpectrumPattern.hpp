@@ -10,9 +10,9 @@
 
 class AudioSpectrumPattern final : public PatternBase
 {
+    static constexpr auto TAG = "AudioSpectrumPattern";
+
     static constexpr float DEFAULT_PEAK_HOLD_TIME = 3.0f;
-    static constexpr float DEFAULT_BAND_NORM_FACTOR = 0.995f;
-    static constexpr float DEFAULT_LOG_SCALE_BASE = 8.0f;
     static constexpr float DEFAULT_ANIMATION_SPEED = 0.0025f;
     static constexpr float DEFAULT_ENERGY_ATTACK_FACTOR = 10.0f;
     static constexpr float DEFAULT_ENERGY_ATTACK_MIN = 0.2f;
@@ -22,8 +22,6 @@ class AudioSpectrumPattern final : public PatternBase
     static constexpr float DEFAULT_ENERGY_DECAY_MAX = 0.95f;
 
     float PEAK_HOLD_TIME;
-    float BAND_NORM_FACTOR;
-    float LOG_SCALE_BASE;
     float ANIMATION_SPEED;
     float ENERGY_ATTACK_FACTOR;
     float ENERGY_ATTACK_MIN;
@@ -32,12 +30,14 @@ class AudioSpectrumPattern final : public PatternBase
     float ENERGY_DECAY_MIN;
     float ENERGY_DECAY_MAX;
 
+    // Wider chains spread the available frequency bins over several columns
+    static constexpr size_t FREQ_BINS = std::min<size_t>(MatrixDriver::WIDTH, Microphone::MAX_FREQ_BINS);
+
     using Spectrum = std::array<float, MatrixDriver::WIDTH>;
     Spectrum spectrum_{};
     Spectrum lastSpectrum_{};
     Spectrum peakLevels_{};
     Spectrum peakHoldCounters_{};
-    Spectrum bandMaxHistory_{};
     Spectrum bandActivity_{};
 
     float dyn_attack_ = 1.0f;
@@ -47,10 +47,10 @@ class AudioSpectrumPattern final : public PatternBase
     bool animationDirectionForward_ = true;
 
 public:
+    static constexpr auto NAME = "AudioSpectrumPattern";
+
     explicit AudioSpectrumPattern(
         const float peak_hold_time = DEFAULT_PEAK_HOLD_TIME,
-        const float band_normalization_factor = DEFAULT_BAND_NORM_FACTOR,
-        const float log_scale_base = DEFAULT_LOG_SCALE_BASE,
         const float animation_speed = DEFAULT_ANIMATION_SPEED,
         const float energy_attack_factor = DEFAULT_ENERGY_ATTACK_FACTOR,
         const float energy_attack_min = DEFAULT_ENERGY_ATTACK_MIN,
@@ -58,10 +58,8 @@ public:
         const float energy_decay_factor = DEFAULT_ENERGY_DECAY_FACTOR,
         const float energy_decay_min = DEFAULT_ENERGY_DECAY_MIN,
         const float energy_decay_max = DEFAULT_ENERGY_DECAY_MAX)
-        : PatternBase("AudioSpectrumPattern"),
+        : PatternBase(NAME),
           PEAK_HOLD_TIME(peak_hold_time),
-          BAND_NORM_FACTOR(band_normalization_factor),
-          LOG_SCALE_BASE(log_scale_base),
           ANIMATION_SPEED(animation_speed),
           ENERGY_ATTACK_FACTOR(energy_attack_factor),
           ENERGY_ATTACK_MIN(energy_attack_min),
@@ -75,8 +73,6 @@ public:
     void from_json(const nlohmann::basic_json<>& j) override
     {
         PEAK_HOLD_TIME = j.value("peak_hold_time", DEFAULT_PEAK_HOLD_TIME);
-        BAND_NORM_FACTOR = j.value("band_norm_factor", DEFAULT_BAND_NORM_FACTOR);
-        LOG_SCALE_BASE = j.value("log_scale_base", DEFAULT_LOG_SCALE_BASE);
         ANIMATION_SPEED = j.value("anim_speed", DEFAULT_ANIMATION_SPEED);
         ENERGY_ATTACK_FACTOR = j.value("energy_attack_factor", DEFAULT_ENERGY_ATTACK_FACTOR);
         ENERGY_ATTACK_MIN = j.value("energy_attack_min", DEFAULT_ENERGY_ATTACK_MIN);
@@ -84,49 +80,61 @@ public:
         ENERGY_DECAY_FACTOR = j.value("energy_decay_factor", DEFAULT_ENERGY_DECAY_FACTOR);
         ENERGY_DECAY_MIN = j.value("energy_decay_min", DEFAULT_ENERGY_DECAY_MIN);
         ENERGY_DECAY_MAX = j.value("energy_decay_max", DEFAULT_ENERGY_DECAY_MAX);
+
+        // Band levels come normalised from the microphone thread now, these no longer have any effect
+        for (const auto key : {"band_norm_factor", "log_scale_base"})
+        {
+            if (j.contains(key)) ESP_LOGW(TAG, "%s is deprecated and ignored", key);
+        }
     }
 
-    void render() override
+    void render(const FrameContext& ctx) override
     {
-        Microphone::getSpectrum(spectrum_);
+        tick(ctx);
 
-        float energy = 0;
+        // Display
+        for (uint16_t x = 0; x < MatrixDriver::WIDTH; ++x)
+        {
+            constexpr size_t m_height_size_t = MatrixDriver::HEIGHT;
+            const size_t height = std::min(static_cast<size_t>(lastSpectrum_[x]), m_height_size_t);
+            const size_t peakHeight = std::min(static_cast<size_t>(peakLevels_[x]), m_height_size_t - 1);
 
-        // Apply logarithmic scaling and per-band normalization
+            for (uint16_t y = 0; y < height; ++y)
+            {
+                using namespace util::math;
+                using namespace util::colors;
+                const float norm = unit_norm(y, m_height_size_t);
+                const float bottom_hue = unit_lerp(GREEN, MAGENTA, animationPhase_);
+                const float hue = unit_lerp(bottom_hue, RED, norm);
+                draw_pixel_hsv(x, m_height_size_t - 1 - y, hue);
+            }
 
+            if (peakHeight > 0)
+            {
+                draw_pixel_rgb(x, m_height_size_t - 1 - peakHeight, 255, 255, 255);
+            }
+        }
+    }
+
+    // Bars, peaks and the hue sweep keep following the audio while hidden, so a fade in starts from the live levels
+    void tick(const FrameContext& ctx) override
+    {
+        // Levels arrive log-compressed and normalized per band from the microphone thread
+        const auto& features = ctx.audio.features;
         for (size_t i = 0; i < MatrixDriver::WIDTH; i++)
         {
-            // Apply compression
-            const float scaledValue = 1.0f + spectrum_[i] * LOG_SCALE_BASE;
-            spectrum_[i] = logf(scaledValue) / logf(1.0f + LOG_SCALE_BASE);
-
-            // Update band max history and normalize
-            bandMaxHistory_[i] = std::max(bandMaxHistory_[i] * BAND_NORM_FACTOR, spectrum_[i]);
-            const float normFactor = std::max(0.01f, bandMaxHistory_[i]);
-            spectrum_[i] = spectrum_[i] / normFactor;
-
-            // Scale to matrix height
-            spectrum_[i] *= MatrixDriver::HEIGHT;
-            energy += spectrum_[i];
+            spectrum_[i] = features.levels[i * FREQ_BINS / MatrixDriver::WIDTH] * MatrixDriver::HEIGHT;
         }
 
         // Apply energy
 
-        energy /= MatrixDriver::WIDTH;
+        const float energy = features.level * MatrixDriver::HEIGHT;
         dyn_attack_ = 1.0f + energy * ENERGY_ATTACK_FACTOR;
         dyn_decay_ = 1.0f - energy * ENERGY_DECAY_FACTOR;
         dyn_attack_ = std::min(std::max(dyn_attack_, ENERGY_ATTACK_MIN), ENERGY_ATTACK_MAX);
         dyn_decay_ = std::min(std::max(dyn_decay_, ENERGY_DECAY_MIN), ENERGY_DECAY_MAX);
 
         // Update animation
-        updateAnimation();
-            }
-            
-            // Separated animation update function to allow partial renders
-            void updateAnimation() 
-            {
-        // Display
-
         if (animationDirectionForward_)
         {
             animationPhase_ += ANIMATION_SPEED;
@@ -146,7 +154,7 @@ public:
             }
         }
 
-        for (uint8_t x = 0; x < MatrixDriver::WIDTH; ++x)
+        for (uint16_t x = 0; x < MatrixDriver::WIDTH; ++x)
         {
             if (const float currentValue = spectrum_[x]; currentValue > lastSpectrum_[x])
             {
@@ -173,25 +181,6 @@ public:
                     peakLevels_[x] *= 0.9f;
                 }
             }
-
-            constexpr size_t m_height_size_t = MatrixDriver::HEIGHT;
-            const size_t height = std::min(static_cast<size_t>(lastSpectrum_[x]), m_height_size_t);
-            const size_t peakHeight = std::min(static_cast<size_t>(peakLevels_[x]), m_height_size_t - 1);
-
-            for (uint8_t y = 0; y < height; ++y)
-            {
-                using namespace util::math;
-                using namespace util::colors;
-                const float norm = unit_norm(y, m_height_size_t);
-                const float bottom_hue = unit_lerp(GREEN, MAGENTA, animationPhase_);
-                const float hue = unit_lerp(bottom_hue, RED, norm);
-                draw_pixel_hsv(x, m_height_size_t - 1 - y, hue);
-            }
-
-            if (peakHeight > 0)
-            {
-                draw_pixel_rgb(x, m_height_size_t - 1 - peakHeight, 255, 255, 255);
-            }
         }
     }
 };
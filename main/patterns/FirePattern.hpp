@@ -14,26 +14,39 @@ private:
     std::vector<uint8_t> heat_;
 
     // Random number generator
-    std::random_device rd_;
+    static uint32_t seed_;
     std::mt19937 gen_;
     std::uniform_int_distribution<> spark_dist_;
     std::uniform_int_distribution<> cooling_dist_;
 
 public:
+    static constexpr auto NAME = "FirePattern";
+
     explicit FirePattern(
         const uint8_t cooling = 55,
         const uint8_t sparking = 120)
-        : PatternBase("FirePattern"),
+        : PatternBase(NAME),
           cooling_(cooling),
           sparking_(sparking),
           heat_(MatrixDriver::WIDTH * MatrixDriver::HEIGHT, 0),
-          gen_(rd_()),
+          gen_(seed_ != 0 ? seed_ : std::random_device{}()),
           spark_dist_(0, 255),
           cooling_dist_(0, cooling_)
     {
         set_render_tick(pdMS_TO_TICKS(30)); // 30ms refresh rate for animation
     }
 
+    // Seed of fire patterns constructed from now on, 0 (the default) draws one from std::random_device
+    static void set_seed(const uint32_t seed)
+    {
+        seed_ = seed;
+    }
+
+    [[nodiscard]] size_t footprint_bytes() const override
+    {
+        return heat_.capacity() * sizeof(uint8_t);
+    }
+
     void from_json(const nlohmann::basic_json<>& j) override
     {
         cooling_ = j.value("cooling", 55);
@@ -41,10 +54,10 @@ public:
         cooling_dist_ = std::uniform_int_distribution<>(0, cooling_);
     }
 
-    void render() override
+    void render(const FrameContext&) override
     {
         // Step 1. Cool down every cell a little
-        for (int i = 0; i < heat_.size(); i++)
+        for (size_t i = 0; i < heat_.size(); i++)
         {
             int cooldown = cooling_dist_(gen_);
 
@@ -102,3 +115,5 @@ public:
         }
     }
 };
+
+uint32_t FirePattern::seed_ = 0;
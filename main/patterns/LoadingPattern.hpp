@@ -7,8 +7,8 @@
 
 class LoadingPattern final : public PatternBase
 {
-    static constexpr uint8_t DEFAULT_CENTER_X = 32;
-    static constexpr uint8_t DEFAULT_CENTER_Y = 32;
+    static constexpr uint8_t DEFAULT_CENTER_X = MatrixDriver::WIDTH / 2;
+    static constexpr uint8_t DEFAULT_CENTER_Y = MatrixDriver::HEIGHT / 2;
     static constexpr uint8_t DEFAULT_DIAMETER = 20;
     static constexpr uint8_t DEFAULT_TRAIL_LENGTH = 18;
     static constexpr uint8_t DEFAULT_POSITIONS = 32;
@@ -22,13 +22,15 @@ class LoadingPattern final : public PatternBase
     uint8_t position_ = 0;
 
 public:
+    static constexpr auto NAME = "LoadingPattern";
+
     explicit LoadingPattern(
-        const uint8_t center_x = 32,
-        const uint8_t center_y = 32,
-        const uint8_t diameter = 20,
-        const uint8_t trail_length = 18,
-        const uint8_t positions = 32)
-        : PatternBase("LoadingPattern"),
+        const uint8_t center_x = DEFAULT_CENTER_X,
+        const uint8_t center_y = DEFAULT_CENTER_Y,
+        const uint8_t diameter = DEFAULT_DIAMETER,
+        const uint8_t trail_length = DEFAULT_TRAIL_LENGTH,
+        const uint8_t positions = DEFAULT_POSITIONS)
+        : PatternBase(NAME),
           CENTER_X(center_x),
           CENTER_Y(center_y),
           DIAMETER(diameter),
@@ -47,22 +49,29 @@ public:
         POSITIONS = j.value("positions", DEFAULT_POSITIONS);
     }
 
-    void render(MatrixGfx& gfx) override
+    void render(const FrameContext& ctx) override
     {
         for (uint8_t i = 0; i < TRAIL_LENGTH; i++)
         {
             const uint8_t position = (position_ + POSITIONS - i) % POSITIONS;
             const float angle = position * 2.0f * M_PI / POSITIONS;
-            const uint8_t x = CENTER_X + static_cast<uint8_t>(DIAMETER * cos(angle));
-            const uint8_t y = CENTER_Y + static_cast<uint8_t>(DIAMETER * sin(angle));
+            // Signed offsets, points left of or above the center would wrap as uint8_t
+            const int16_t x = CENTER_X + static_cast<int16_t>(DIAMETER * cosf(angle));
+            const int16_t y = CENTER_Y + static_cast<int16_t>(DIAMETER * sinf(angle));
+            if (x < 0 || y < 0) continue;
 
             const float norm = util::math::unit_norm(i, TRAIL_LENGTH);
             const float hue = util::math::unit_lerp(util::colors::MAGENTA, util::colors::RED, norm);
             const float brightness = util::math::unit_lerp(1.0f, 0.5f, norm);
 
-            gfx.draw_pixel_hsv(x, y, hue, 1.0f, brightness);
+            draw_pixel_hsv(x, y, hue, 1.0f, brightness);
         }
 
+        tick(ctx);
+    }
+
+    void tick(const FrameContext&) override
+    {
         position_ = (position_ + 1) % POSITIONS;
     }
 };
@@ -37,8 +37,8 @@ public:
         blue_ = j.value("blue", 0);
     }
 
-    void render(MatrixGfx& gfx) override
+    void render(const FrameContext&) override
     {
-        gfx.draw_pixel_rgb(x_, y_, red_, green_, blue_);
+        draw_pixel_rgb(x_, y_, red_, green_, blue_);
     }
 };
@@ -9,11 +9,13 @@ class SolidColorPattern final : public PatternBase
     uint8_t blue_;
 
 public:
+    static constexpr auto NAME = "SolidColorPattern";
+
     explicit SolidColorPattern(
         const uint8_t r = 0,
         const uint8_t g = 0,
         const uint8_t b = 0)
-        : PatternBase("SolidColorPattern"),
+        : PatternBase(NAME),
           red_(r),
           green_(g),
           blue_(b)
@@ -27,8 +29,8 @@ public:
         blue_ = j.value("blue", 0);
     }
 
-    void render(MatrixGfx& gfx) override
+    void render(const FrameContext&) override
     {
-        gfx.fill_rgb(red_, green_, blue_);
+        fill_rgb(red_, green_, blue_);
     }
 };
@@ -7,8 +7,8 @@ class WifiConnectingPattern final : public PatternBase
     static constexpr auto TAG = "WifiConnectingPattern";
 
     // WiFi symbol configuration
-    static constexpr uint8_t CENTER_X = 32; // Center of the display
-    static constexpr uint8_t CENTER_Y = 32; // Center of the display
+    static constexpr uint16_t CENTER_X = MatrixDriver::WIDTH / 2; // Center of the display
+    static constexpr uint16_t CENTER_Y = MatrixDriver::HEIGHT / 2; // Center of the display
     static constexpr uint8_t DOT_RADIUS = 2; // Radius of the WiFi dot
     static constexpr uint8_t NUM_ARCS = 4; // Number of WiFi signal arcs
     static constexpr uint8_t ARC_SPACING = 5; // Spacing between arcs
@@ -72,7 +72,7 @@ class WifiConnectingPattern final : public PatternBase
     }
 
     // Draw a filled circle
-    void drawFilledCircle(const uint8_t x, const uint8_t y, const uint8_t radius,
+    void drawFilledCircle(const uint16_t x, const uint16_t y, const uint8_t radius,
                           const uint8_t r, const uint8_t g, const uint8_t b)
     {
         for (int16_t dx = -radius; dx <= radius; dx++)
@@ -88,7 +88,7 @@ class WifiConnectingPattern final : public PatternBase
     }
 
     // Draw an arc
-    void drawArc(const uint8_t x, const uint8_t y, const uint8_t radius, const uint8_t thickness,
+    void drawArc(const uint16_t x, const uint16_t y, const uint8_t radius, const uint8_t thickness,
                  const uint16_t start_angle, const uint16_t end_angle, const uint8_t r, const uint8_t g,
                  const uint8_t b)
     {
@@ -154,7 +154,10 @@ class WifiConnectingPattern final : public PatternBase
             (static_cast<uint16_t>(WIFI_B) * dot_brightness / 255));
 
         drawFilledCircle(CENTER_X, CENTER_Y, DOT_RADIUS, r, g, b);
+    }
 
+    void advanceFrame()
+    {
         // Increment frame counter
         frame_count_++;
 
@@ -166,14 +169,22 @@ class WifiConnectingPattern final : public PatternBase
     }
 
 public:
-    WifiConnectingPattern() : PatternBase("WifiConnectingPattern")
+    static constexpr auto NAME = "WifiConnectingPattern";
+
+    WifiConnectingPattern() : PatternBase(NAME)
     {
         // Set default render speed for smooth animation
         set_render_tick(pdMS_TO_TICKS(33)); // ~30fps
     }
 
-    void render() override
+    void render(const FrameContext&) override
     {
         drawWiFiSymbol();
+        advanceFrame();
+    }
+
+    void tick(const FrameContext&) override
+    {
+        advanceFrame();
     }
 };
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace util
+{
+    // What AudioFeatureTracker derives from each hop's bands, published next to the spectrum
+    template <size_t BANDS>
+    struct AudioFeatures
+    {
+        std::array<float, BANDS> levels; // Log-compressed bands, each over its own decaying peak, 0 to 1
+        std::array<float, BANDS> rms; // Short-term RMS of each band times gain, around 0 to 1
+        float level; // Mean of levels
+        float loudness; // Short-term RMS over all bands times gain, around 0 to 1
+        float gain; // Automatic gain that brings the recent loudness peak to 1
+        float flux; // Positive spectral flux of the latest hop
+        uint32_t onsets; // Onsets detected so far, compare with the last count seen rather than polling a flag
+        float tempo_bpm; // 0 while no tempo is established
+        float beat_confidence; // 0 to 1
+        float beat_phase; // 0 on a beat rising to 1 at the next, as of the latest hop
+        uint32_t beats; // Beats predicted so far
+    };
+
+    /**
+     * @brief Onsets, tempo, beat phase, band RMS and gain control from a stream of band magnitudes
+     *
+     * Fed one spectrum per hop by the microphone thread, so every pattern reads the same features instead of deriving
+     * its own. Onsets are spectral flux peaks above an adaptive threshold. Tempo is the autocorrelation peak of the
+     * flux envelope between MIN_BPM and MAX_BPM, weighted towards PRIOR_BPM, and a phase that advances once per beat
+     * period is pulled towards onsets that land near a predicted beat. Update cost is a log per band per hop, plus an
+     * autocorrelation every TEMPO_INTERVAL envelope samples.
+     */
+    template <size_t BANDS>
+    class AudioFeatureTracker final
+    {
+        // Levels, per band log compression and peak normalisation
+        static constexpr float LEVEL_LOG_BASE = 8.0f;
+        static constexpr float LEVEL_PEAK_TAU_S = 3.2f;
+        static constexpr float LEVEL_FLOOR = 0.01f;
+
+        // RMS and gain control on raw magnitudes
+        static constexpr float RMS_TAU_S = 0.05f;
+        static constexpr float AGC_RELEASE_TAU_S = 10.0f;
+        static constexpr float AGC_FLOOR = 0.05f; // Keeps silence from being amplified into noise
+
+        // Onsets
+        static constexpr float FLUX_MEAN_TAU_S = 0.5f;
+        static constexpr float ONSET_DEVIATIONS = 5.0f; // Mean absolute deviations above the mean flux
+        static constexpr float ONSET_MIN_FLUX = 0.002f;
+        static constexpr float ONSET_MIN_INTERVAL_S = 0.1f;
+
+        // Tempo, on the flux envelope resampled to about ENVELOPE_HZ. The beat usually sits in the bass, which the
+        // envelope weights on top of the full band flux so off-beat hi-hats do not take the phase.
+        static constexpr size_t BASS_BANDS = std::max<size_t>(1, BANDS / 4);
+        static constexpr float BASS_EMPHASIS = 1.0f;
+        static constexpr float ENVELOPE_HZ = 100.0f;
+        static constexpr size_t TEMPO_HISTORY = 512;
+        static constexpr size_t TEMPO_INTERVAL = 16;
+        static constexpr float MIN_BPM = 60.0f;
+        static constexpr float MAX_BPM = 180.0f;
+        static constexpr float PRIOR_BPM = 120.0f;
+        static constexpr float PRIOR_OCTAVES = 1.0f;
+        static constexpr float MIN_CONFIDENCE = 0.1f;
+        static constexpr float TEMPO_SMOOTHING = 0.25f; // Weight of a new estimate close to the current tempo
+        static constexpr float TEMPO_TOLERANCE = 0.08f; // Relative difference that counts as close
+
+        // Beat phase
+        static constexpr size_t COMB_BEATS = 8; // Recent beats the envelope is folded over to place the beat
+        static constexpr float COMB_GAIN = 0.5f;
+        static constexpr float PHASE_WINDOW = 0.25f; // Onsets further than this from a predicted beat are ignored
+        static constexpr float PHASE_GAIN = 0.2f;
+
+        const float hop_rate_hz_;
+        const float level_peak_decay_;
+        const float rms_alpha_;
+        const float agc_release_;
+        const float flux_mean_alpha_;
+        const uint32_t onset_min_hops_;
+        const uint32_t onset_warmup_hops_;
+        const uint32_t envelope_decimation_;
+        const size_t min_lag_;
+        const size_t max_lag_;
+
+        std::array<float, BANDS> compressed_{};
+        std::array<float, BANDS> peaks_{};
+        std::array<float, BANDS> power_{};
+        float agc_peak_ = 0.0f;
+
+        float flux_mean_ = 0.0f;
+        float flux_deviation_ = 0.0f;
+        uint32_t hops_since_onset_ = UINT32_MAX;
+        uint32_t flux_hops_ = 0;
+        uint32_t onsets_ = 0;
+
+        std::array<float, TEMPO_HISTORY> envelope_{}; // Ring, oldest at envelope_head_
+        std::array<float, TEMPO_HISTORY> ordered_{}; // Scratch for the autocorrelation
+        size_t envelope_head_ = 0;
+        size_t envelope_count_ = 0;
+        float envelope_acc_ = 0.0f;
+        uint32_t envelope_hops_ = 0;
+
+        float period_hops_ = 0.0f; // 0 while no tempo is established
+        float confidence_ = 0.0f;
+        float phase_ = 0.0f;
+        float comb_phase_ = -1.0f; // Phase of the latest hop by the latest estimate, negative once applied
+        uint32_t beats_ = 0;
+
+        [[nodiscard]] static float decay(const float hop_s, const float tau_s)
+        {
+            return std::exp(-hop_s / tau_s);
+        }
+
+        [[nodiscard]] float onsetThreshold() const
+        {
+            return std::max(flux_mean_ + flux_deviation_ * ONSET_DEVIATIONS, ONSET_MIN_FLUX);
+        }
+
+        bool detectOnset(const float flux)
+        {
+            if (hops_since_onset_ != UINT32_MAX) hops_since_onset_++;
+
+            const bool onset = flux > onsetThreshold() && hops_since_onset_ >= onset_min_hops_ &&
+                flux_hops_ >= onset_warmup_hops_;
+            if (onset)
+            {
+                onsets_++;
+                hops_since_onset_ = 0;
+            }
+            return onset;
+        }
+
+        // Keeps the strongest novelty of each envelope period, returns true when a sample was completed
+        bool pushEnvelope(const float novelty)
+        {
+            envelope_acc_ = std::max(envelope_acc_, novelty);
+            if (++envelope_hops_ < envelope_decimation_) return false;
+
+            envelope_[envelope_head_] = envelope_acc_;
+            envelope_head_ = (envelope_head_ + 1) % TEMPO_HISTORY;
+            envelope_count_ = std::min(envelope_count_ + 1, TEMPO_HISTORY);
+            envelope_acc_ = 0.0f;
+            envelope_hops_ = 0;
+            return true;
+        }
+
+        // Normalised autocorrelation of the mean-removed envelope at one lag
+        [[nodiscard]] float autocorrelation(const size_t lag) const
+        {
+            float sum = 0.0f;
+            for (size_t n = lag; n < TEMPO_HISTORY; n++)
+            {
+                sum += ordered_[n] * ordered_[n - lag];
+            }
+            return sum / static_cast<float>(TEMPO_HISTORY - lag);
+        }
+
+        void estimateTempo()
+        {
+            // Oldest first through a [1 2 1] / 4 smoother, which keeps a beat period that falls between two lags
+            // from losing out to an octave below that lands on a whole lag
+            float mean = 0.0f;
+            for (size_t i = 0; i < TEMPO_HISTORY; i++)
+            {
+                const float prev = envelope_[(envelope_head_ + i + TEMPO_HISTORY - 1) % TEMPO_HISTORY];
+                const float next = envelope_[(envelope_head_ + i + 1) % TEMPO_HISTORY];
+                ordered_[i] = 0.25f * prev + 0.5f * envelope_[(envelope_head_ + i) % TEMPO_HISTORY] + 0.25f * next;
+                mean += ordered_[i];
+            }
+            mean /= TEMPO_HISTORY;
+            for (auto& x : ordered_)
+            {
+                x -= mean;
+            }
+
+            const float energy = autocorrelation(0);
+            if (energy <= 0.0f)
+            {
+                confidence_ = 0.0f;
+                return;
+            }
+
+            const float envelope_hz = hop_rate_hz_ / static_cast<float>(envelope_decimation_);
+            size_t best_lag = 0;
+            float best_score = 0.0f;
+            for (size_t lag = min_lag_; lag <= max_lag_; lag++)
+            {
+                const float bpm = 60.0f * envelope_hz / static_cast<float>(lag);
+                const float octaves = std::log2(bpm / PRIOR_BPM) / PRIOR_OCTAVES;
+                const float score = autocorrelation(lag) * std::exp(-0.5f * octaves * octaves);
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best_lag = lag;
+                }
+            }
+
+            const float peak = best_lag != 0 ? autocorrelation(best_lag) : 0.0f;
+            confidence_ = std::clamp(peak / energy, 0.0f, 1.0f);
+            if (confidence_ < MIN_CONFIDENCE)
+            {
+                return;
+            }
+
+            // Parabolic interpolation between the neighbouring lags for a finer period
+            const float before = autocorrelation(best_lag - 1);
+            const float after = autocorrelation(best_lag + 1);
+            const float curvature = before - 2.0f * peak + after;
+            const float offset = curvature < 0.0f ? std::clamp(0.5f * (before - after) / curvature, -0.5f, 0.5f) : 0.0f;
+            const float period = (static_cast<float>(best_lag) + offset) * static_cast<float>(envelope_decimation_);
+
+            if (period_hops_ > 0.0f && std::abs(period - period_hops_) < TEMPO_TOLERANCE * period_hops_)
+            {
+                period_hops_ += (period - period_hops_) * TEMPO_SMOOTHING;
+            }
+            else
+            {
+                period_hops_ = period;
+            }
+
+            // Fold the latest beats onto one period, the strongest offset is how long ago the last beat fell
+            const float period_samples = period_hops_ / static_cast<float>(envelope_decimation_);
+            const auto offsets = static_cast<size_t>(period_samples);
+            size_t best_offset = 0;
+            float best_sum = -INFINITY;
+            for (size_t offset = 0; offset < offsets; offset++)
+            {
+                float sum = 0.0f;
+                for (size_t k = 0; k < COMB_BEATS; k++)
+                {
+                    const auto back = offset + static_cast<size_t>(std::lround(k * period_samples));
+                    if (back >= TEMPO_HISTORY) break;
+                    sum += ordered_[TEMPO_HISTORY - 1 - back];
+                }
+                if (sum > best_sum)
+                {
+                    best_sum = sum;
+                    best_offset = offset;
+                }
+            }
+            comb_phase_ = static_cast<float>(best_offset) / period_samples;
+        }
+
+        void advancePhase(const bool onset)
+        {
+            if (period_hops_ <= 0.0f) return;
+
+            phase_ += 1.0f / period_hops_;
+
+            // A fresh tempo estimate moves the phase towards where the envelope places the beat, which keeps it on
+            // the strong pulse rather than off-beats
+            if (comb_phase_ >= 0.0f)
+            {
+                const float error = std::remainder(phase_ - comb_phase_, 1.0f);
+                phase_ -= error * COMB_GAIN;
+                comb_phase_ = -1.0f;
+            }
+
+            // An onset close to a predicted beat pulls the phase towards it
+            if (onset && confidence_ >= MIN_CONFIDENCE)
+            {
+                const float error = std::remainder(phase_, 1.0f);
+                if (std::abs(error) < PHASE_WINDOW)
+                {
+                    phase_ -= error * PHASE_GAIN;
+                }
+            }
+
+            if (phase_ >= 1.0f)
+            {
+                phase_ -= 1.0f;
+                beats_++;
+            }
+            else if (phase_ < 0.0f)
+            {
+                phase_ += 1.0f;
+            }
+        }
+
+    public:
+        explicit AudioFeatureTracker(const float hop_rate_hz)
+            : hop_rate_hz_(hop_rate_hz),
+              level_peak_decay_(decay(1.0f / hop_rate_hz, LEVEL_PEAK_TAU_S)),
+              rms_alpha_(1.0f - decay(1.0f / hop_rate_hz, RMS_TAU_S)),
+              agc_release_(decay(1.0f / hop_rate_hz, AGC_RELEASE_TAU_S)),
+              flux_mean_alpha_(1.0f - decay(1.0f / hop_rate_hz, FLUX_MEAN_TAU_S)),
+              onset_min_hops_(static_cast<uint32_t>(std::ceil(ONSET_MIN_INTERVAL_S * hop_rate_hz))),
+              onset_warmup_hops_(static_cast<uint32_t>(std::ceil(FLUX_MEAN_TAU_S * hop_rate_hz))),
+              envelope_decimation_(std::max(1u, static_cast<uint32_t>(std::lround(hop_rate_hz / ENVELOPE_HZ)))),
+              min_lag_(static_cast<size_t>(
+                  std::floor(60.0f * hop_rate_hz / envelope_decimation_ / MAX_BPM))),
+              max_lag_(std::min(TEMPO_HISTORY / 2, static_cast<size_t>(
+                  std::ceil(60.0f * hop_rate_hz / envelope_decimation_ / MIN_BPM))))
+        {
+        }
+
+        // Fold in the next hop's band magnitudes and write the updated features to out
+        void update(const std::array<float, BANDS>& bands, AudioFeatures<BANDS>& out)
+        {
+            static const float LOG_NORM = 1.0f / std::log(1.0f + LEVEL_LOG_BASE);
+
+            float flux = 0.0f;
+            float bass_flux = 0.0f;
+            float level_sum = 0.0f;
+            float power_sum = 0.0f;
+
+            for (size_t i = 0; i < BANDS; i++)
+            {
+                const float magnitude = bands[i];
+                const float compressed = std::log(1.0f + magnitude * LEVEL_LOG_BASE) * LOG_NORM;
+
+                const float rise = std::max(0.0f, compressed - compressed_[i]);
+                flux += rise;
+                if (i < BASS_BANDS) bass_flux += rise;
+                compressed_[i] = compressed;
+
+                peaks_[i] = std::max(peaks_[i] * level_peak_decay_, compressed);
+                out.levels[i] = compressed / std::max(LEVEL_FLOOR, peaks_[i]);
+                level_sum += out.levels[i];
+
+                power_[i] += (magnitude * magnitude - power_[i]) * rms_alpha_;
+                power_sum += power_[i];
+            }
+            flux /= BANDS;
+            bass_flux /= BASS_BANDS;
+
+            const float loudness = std::sqrt(power_sum / BANDS);
+            agc_peak_ = std::max(loudness, agc_peak_ * agc_release_);
+            const float gain = 1.0f / std::max(agc_peak_, AGC_FLOOR);
+
+            for (size_t i = 0; i < BANDS; i++)
+            {
+                out.rms[i] = std::sqrt(power_[i]) * gain;
+            }
+
+            const bool onset = detectOnset(flux);
+            // Once warmed up the statistics follow the flux between onsets, onsets themselves would raise the
+            // threshold more the larger the share of hops they fill, which grows with the hop size
+            const float background = flux_hops_ < onset_warmup_hops_ ? flux : std::min(flux, onsetThreshold());
+            flux_hops_ = std::min(flux_hops_ + 1, onset_warmup_hops_);
+            flux_deviation_ += (std::abs(background - flux_mean_) - flux_deviation_) * flux_mean_alpha_;
+            flux_mean_ += (background - flux_mean_) * flux_mean_alpha_;
+
+            if (pushEnvelope(flux + bass_flux * BASS_EMPHASIS) && envelope_count_ == TEMPO_HISTORY &&
+                envelope_head_ % TEMPO_INTERVAL == 0)
+            {
+                estimateTempo();
+            }
+            advancePhase(onset);
+
+            out.level = level_sum / BANDS;
+            out.loudness = loudness * gain;
+            out.gain = gain;
+            out.flux = flux;
+            out.onsets = onsets_;
+            out.tempo_bpm = period_hops_ > 0.0f && confidence_ >= MIN_CONFIDENCE
+                                ? 60.0f * hop_rate_hz_ / period_hops_
+                                : 0.0f;
+            out.beat_confidence = confidence_;
+            out.beat_phase = phase_;
+            out.beats = beats_;
+        }
+    };
+}
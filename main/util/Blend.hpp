@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+namespace util::blend
+{
+    // Weights are 8.8 fixed point, a full weight is ONE
+    static constexpr uint16_t ONE = 256;
+
+    /**
+     * @brief Quantizes blend weights to 8.8 fixed point, normalized to sum to exactly ONE
+     *
+     * Each weight is the difference of the rounded running sums, so the rounding errors never add up beyond half a
+     * step and a lone non-zero weight becomes ONE. Zero and negative weights stay zero. Returns false, leaving out
+     * untouched, when nothing has weight.
+     */
+    inline bool normalize(const std::span<const float> weights, const std::span<uint16_t> out)
+    {
+        float total = 0.0f;
+        for (const float w : weights)
+        {
+            total += std::max(w, 0.0f);
+        }
+        if (total <= 0.0f) return false;
+
+        const float scale = ONE / total;
+        float running = 0.0f;
+        uint16_t assigned = 0;
+        size_t last = 0;
+        for (size_t i = 0; i < weights.size(); i++)
+        {
+            running += std::max(weights[i], 0.0f);
+            const auto upto = static_cast<uint16_t>(std::min<long>(std::lround(running * scale), ONE));
+            out[i] = upto - assigned;
+            assigned = upto;
+            if (weights[i] > 0.0f) last = i;
+        }
+        out[last] += ONE - assigned; // In case float error in the total left the sum a step short
+        return true;
+    }
+
+    /**
+     * @brief Weighted sum of packed 0x00RRGGBB pixels
+     *
+     * Red and blue share one 32-bit multiply-accumulate and green takes another: each channel times a weight of at
+     * most ONE fits in 16 bits, and with weights summing to ONE so does the sum, so the channels never carry into
+     * each other. Rounds to nearest. Against the float blend a channel is within one step for up to four sources and
+     * two for up to eight, the weights' 1/256 quantization being the rest of the error.
+     */
+    inline void mix(const std::span<const uint32_t* const> sources, const std::span<const uint16_t> weights,
+                    uint32_t* dest, const size_t count)
+    {
+        static constexpr uint32_t RB_MASK = 0x00FF00FF;
+        static constexpr uint32_t G_MASK = 0x0000FF00;
+        static constexpr uint32_t RB_HALF = 0x00800080;
+        static constexpr uint32_t G_HALF = 0x00008000;
+
+        // A lone source at full weight is a copy, one at less weight (e.g. the others had no buffer) is scaled below
+        if (sources.size() == 1 && weights[0] == ONE)
+        {
+            std::copy_n(sources[0], count, dest);
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t rb = RB_HALF;
+            uint32_t g = G_HALF;
+            for (size_t k = 0; k < sources.size(); k++)
+            {
+                const uint32_t pixel = sources[k][i];
+                rb += (pixel & RB_MASK) * weights[k];
+                g += (pixel & G_MASK) * weights[k];
+            }
+            dest[i] = ((rb >> 8) & RB_MASK) | ((g >> 8) & G_MASK);
+        }
+    }
+}
@@ -1,50 +1,304 @@
-﻿#pragma once
+#pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
 #include <complex>
+#include <cstdint>
+#include <span>
 
 namespace util
 {
-    static void fft_recursive_impl(std::complex<float>* x_data, size_t N, std::complex<float>* scratch_data);
+    // Symmetric Hann window, w[i] = 0.5 * (1 - cos(2 pi i / (N - 1))), computed once per size
+    template <size_t N>
+    const std::array<float, N>& hann_window()
+    {
+        static const std::array<float, N> window = []
+        {
+            std::array<float, N> w{};
+            for (size_t i = 0; i < N; i++)
+            {
+                w[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * static_cast<float>(i) / static_cast<float>(N - 1)));
+            }
+            return w;
+        }();
+        return window;
+    }
 
-    inline void fft(std::vector<std::complex<float>>& x)
+    // Bit-reversal permutation of N elements as a constexpr list of swaps
+    template <size_t N>
+    class BitReversal final
     {
-        const size_t N = x.size();
-        if (N == 0) return;
+        static_assert(N <= 65536, "Bit-reversal table stores 16-bit indices");
+
+        static constexpr size_t LOG2_N = std::countr_zero(N);
 
-        if ((N > 1) && (N & (N - 1)) != 0)
+        static constexpr size_t reverse(const size_t i)
         {
-            ESP_LOGE("FFT", "FFT size %zu is not a power of 2. Aborting FFT.", N);
-            return;
+            size_t r = 0;
+            for (size_t b = 0; b < LOG2_N; b++)
+            {
+                r |= ((i >> b) & 1) << (LOG2_N - 1 - b);
+            }
+            return r;
         }
-        if (N <= 1) return;
 
-        std::vector<std::complex<float>> scratch(N);
-        fft_recursive_impl(x.data(), N, scratch.data());
-    }
+        // Index pairs exchanged by the bit-reversal permutation, each pair once
+        static constexpr size_t SWAP_COUNT = []
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < N; i++)
+            {
+                n += i < reverse(i);
+            }
+            return n;
+        }();
 
-    static void fft_recursive_impl(std::complex<float>* x_data, const size_t N, std::complex<float>* scratch_data)
+        static constexpr std::array<std::pair<uint16_t, uint16_t>, SWAP_COUNT> SWAPS = []
+        {
+            std::array<std::pair<uint16_t, uint16_t>, SWAP_COUNT> swaps{};
+            size_t n = 0;
+            for (size_t i = 0; i < N; i++)
+            {
+                if (i < reverse(i)) swaps[n++] = {static_cast<uint16_t>(i), static_cast<uint16_t>(reverse(i))};
+            }
+            return swaps;
+        }();
+
+    public:
+        BitReversal() = delete;
+
+        template <typename T>
+        static void permute(const std::span<T, N> x)
+        {
+            for (const auto& [i, j] : SWAPS)
+            {
+                std::swap(x[i], x[j]);
+            }
+        }
+    };
+
+    /**
+     * @brief Fixed-size in-place FFT
+     *
+     * Radix-4 decimation-in-frequency stages (plus one radix-2 stage when log2(N) is odd) followed by a bit-reversal
+     * permutation. Twiddles and the permutation are tables built once per size, a transform does no allocation and no
+     * trigonometry.
+     */
+    template <size_t N>
+    class Fft final
     {
-        if (N <= 1) return;
+        static_assert(N >= 4 && std::has_single_bit(N), "FFT size must be a power of two of at least 4");
+
+    public:
+        using Complex = std::complex<float>;
 
-        std::complex<float>* even_part_in_scratch = scratch_data;
-        std::complex<float>* odd_part_in_scratch = scratch_data + N / 2;
+        Fft() = delete;
 
-        for (size_t i = 0; i < N / 2; i++)
+        static void transform(const std::span<Complex, N> x)
         {
-            even_part_in_scratch[i] = x_data[2 * i];
-            odd_part_in_scratch[i] = x_data[2 * i + 1];
+            size_t span = N;
+            for (; span >= 4; span /= 4)
+            {
+                radix4Stage(x, span);
+            }
+            if (span == 2)
+            {
+                for (size_t i = 0; i < N; i += 2)
+                {
+                    const Complex a = x[i];
+                    x[i] = a + x[i + 1];
+                    x[i + 1] = a - x[i + 1];
+                }
+            }
+
+            BitReversal<N>::permute(x);
         }
 
-        fft_recursive_impl(even_part_in_scratch, N / 2, x_data);
-        fft_recursive_impl(odd_part_in_scratch, N / 2, x_data + N / 2);
+    private:
+        // W^k = exp(-2 pi i k / N) for k < 3N/4, the largest power a radix-4 butterfly uses
+        static inline const std::array<Complex, 3 * N / 4> TWIDDLES = []
+        {
+            std::array<Complex, 3 * N / 4> w{};
+            for (size_t k = 0; k < w.size(); k++)
+            {
+                const double angle = -2.0 * M_PI * static_cast<double>(k) / N;
+                w[k] = Complex(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+            }
+            return w;
+        }();
+
+        // Plain complex product, operator* goes through __mulsc3 for C99 NaN/inf handling unless built with fast-math
+        static Complex mul(const Complex a, const Complex b)
+        {
+            return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+        }
 
-        for (size_t k = 0; k < N / 2; k++)
+        // One radix-4 DIF pass over blocks of span points. Outputs 1 and 2 trade places so the result ends up in
+        // plain bit-reversed order, the same as two radix-2 passes would leave it.
+        static void radix4Stage(const std::span<Complex, N> x, const size_t span)
         {
-            const float angle = -2.0f * M_PI * static_cast<float>(k) / static_cast<float>(N);
-            const std::complex<float> t = std::polar(1.0f, angle) * odd_part_in_scratch[k];
+            const size_t quarter = span / 4;
+            const size_t stride = N / span;
+
+            for (size_t base = 0; base < N; base += span)
+            {
+                Complex* const p = x.data() + base;
+                for (size_t j = 0; j < quarter; j++)
+                {
+                    const Complex a0 = p[j];
+                    const Complex a1 = p[j + quarter];
+                    const Complex a2 = p[j + 2 * quarter];
+                    const Complex a3 = p[j + 3 * quarter];
 
-            x_data[k] = even_part_in_scratch[k] + t;
-            x_data[k + N / 2] = even_part_in_scratch[k] - t;
+                    const Complex t0 = a0 + a2;
+                    const Complex t1 = a0 - a2;
+                    const Complex t2 = a1 + a3;
+                    const Complex d = a1 - a3;
+                    const Complex t3(d.imag(), -d.real()); // -i * (a1 - a3)
+
+                    p[j] = t0 + t2;
+                    if (j == 0)
+                    {
+                        p[j + quarter] = t0 - t2;
+                        p[j + 2 * quarter] = t1 + t3;
+                        p[j + 3 * quarter] = t1 - t3;
+                    }
+                    else
+                    {
+                        p[j + quarter] = mul(t0 - t2, TWIDDLES[2 * j * stride]);
+                        p[j + 2 * quarter] = mul(t1 + t3, TWIDDLES[j * stride]);
+                        p[j + 3 * quarter] = mul(t1 - t3, TWIDDLES[3 * j * stride]);
+                    }
+                }
+            }
         }
-    }
+    };
+
+    /**
+     * @brief FFT of N real samples through an N/2-point complex FFT
+     *
+     * Even samples go in the real parts and odd samples in the imaginary parts. The half-size transform is then
+     * split into the spectrum of the real signal. Half the work and half the buffer of a complex FFT with zero
+     * imaginary parts.
+     */
+    template <size_t N>
+    class RealFft final
+    {
+        static_assert(N >= 8, "Real FFT size must be at least 8");
+
+    public:
+        using Complex = std::complex<float>;
+
+        RealFft() = delete;
+
+        // x holds the samples as pairs, x[n] = {s[2n], s[2n + 1]}. On return x[k] is bin k for 0 < k < N/2, and
+        // x[0] holds bin 0 in the real part and the Nyquist bin N/2 in the imaginary part, both purely real.
+        static void transform(const std::span<Complex, N / 2> x)
+        {
+            Fft<N / 2>::transform(x);
+
+            const Complex z0 = x[0];
+            x[0] = {z0.real() + z0.imag(), z0.real() - z0.imag()};
+
+            // Bins k and N/2 - k come from the same pair of half-size outputs. With a = Z[k], b = conj(Z[N/2 - k]):
+            // even = (a + b) / 2, odd = (a - b) / 2i, X[k] = even + W^k odd, X[N/2 - k] = conj(even - W^k odd)
+            for (size_t k = 1; k <= N / 4; k++)
+            {
+                const size_t m = N / 2 - k;
+                const float ar = x[k].real(), ai = x[k].imag();
+                const float br = x[m].real(), bi = -x[m].imag();
+
+                const float even_r = 0.5f * (ar + br);
+                const float even_i = 0.5f * (ai + bi);
+                const float odd_r = 0.5f * (ai - bi);
+                const float odd_i = -0.5f * (ar - br);
+
+                const float wr = TWIDDLES[k].real(), wi = TWIDDLES[k].imag();
+                const float tr = wr * odd_r - wi * odd_i;
+                const float ti = wr * odd_i + wi * odd_r;
+
+                x[k] = {even_r + tr, even_i + ti};
+                x[m] = {even_r - tr, ti - even_i};
+            }
+        }
+
+        // Magnitude of bin k < N/2 after transform()
+        static float magnitude(const std::span<const Complex, N / 2> x, const size_t k)
+        {
+            if (k == 0) return std::fabs(x[0].real());
+            return std::sqrt(x[k].real() * x[k].real() + x[k].imag() * x[k].imag());
+        }
+
+    private:
+        // W^k = exp(-2 pi i k / N) for k <= N/4
+        static inline const std::array<Complex, N / 4 + 1> TWIDDLES = []
+        {
+            std::array<Complex, N / 4 + 1> w{};
+            for (size_t k = 0; k < w.size(); k++)
+            {
+                const double angle = -2.0 * M_PI * static_cast<double>(k) / N;
+                w[k] = Complex(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+            }
+            return w;
+        }();
+    };
+
+    /**
+     * @brief Magnitudes of the first BINS bins of an N-point DFT by the Goertzel recurrence
+     *
+     * Costs about BINS * N multiply-adds against roughly N/4 * log2(N) complex butterflies for the real FFT, so it
+     * only wins when very few bins are needed.
+     */
+    template <size_t N, size_t BINS>
+    class Goertzel final
+    {
+        static_assert(BINS <= N / 2, "Goertzel bins must be below Nyquist");
+
+    public:
+        Goertzel() = delete;
+
+        static void magnitudes(const std::span<const float, N> x, const std::span<float, BINS> out)
+        {
+            // LANES bins share each pass over the samples, independent recurrences keep the FPU pipeline busy
+            for (size_t k0 = 0; k0 < BINS; k0 += LANES)
+            {
+                const size_t lanes = std::min(LANES, BINS - k0);
+                std::array<float, LANES> s1{};
+                std::array<float, LANES> s2{};
+
+                for (size_t n = 0; n < N; n++)
+                {
+                    for (size_t l = 0; l < LANES; l++)
+                    {
+                        const float s0 = x[n] + COEFFS[k0 + l] * s1[l] - s2[l];
+                        s2[l] = s1[l];
+                        s1[l] = s0;
+                    }
+                }
+
+                for (size_t l = 0; l < lanes; l++)
+                {
+                    const float power = s1[l] * s1[l] + s2[l] * s2[l] - COEFFS[k0 + l] * s1[l] * s2[l];
+                    out[k0 + l] = std::sqrt(std::max(0.0f, power));
+                }
+            }
+        }
+
+    private:
+        static constexpr size_t LANES = 4;
+        static constexpr size_t PADDED_BINS = (BINS + LANES - 1) / LANES * LANES;
+
+        // 2 cos(2 pi k / N), padded to whole lanes, the padding bins are computed and dropped
+        static inline const std::array<float, PADDED_BINS> COEFFS = []
+        {
+            std::array<float, PADDED_BINS> c{};
+            for (size_t k = 0; k < PADDED_BINS; k++)
+            {
+                c[k] = static_cast<float>(2.0 * std::cos(2.0 * M_PI * static_cast<double>(k) / N));
+            }
+            return c;
+        }();
+    };
 }
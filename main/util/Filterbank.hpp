@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace util
+{
+    enum class BandScale : uint8_t
+    {
+        LINEAR, // Band b is FFT bin b
+        LOG, // Equal frequency ratio per band, i.e. fractions of an octave
+        MEL, // Equal steps on the mel scale, linear below ~1 kHz and logarithmic above
+    };
+
+    /**
+     * @brief Maps BINS linear FFT magnitudes onto BANDS bands
+     *
+     * Each band is a triangle reaching from its lower to its upper neighbour's center with a peak weight of 1, so a
+     * pure tone reads about its bin magnitude in whichever band it falls. Bands narrower than the bin spacing
+     * interpolate between the two bins around their center instead. Only non-zero weights are stored, applying costs
+     * one multiply-add per weight, about two per bin.
+     */
+    template <size_t BINS, size_t BANDS>
+    class Filterbank final
+    {
+        struct Band
+        {
+            uint16_t first_bin;
+            uint16_t count;
+            uint16_t offset; // Into weights_
+        };
+
+        // Triangles overlap pairwise so every bin is used by at most two bands, plus interpolated narrow bands
+        static constexpr size_t MAX_WEIGHTS = 2 * BINS + 2 * BANDS;
+
+        std::array<Band, BANDS> bands_{};
+        std::array<float, MAX_WEIGHTS> weights_{};
+
+        static float toScale(const BandScale scale, const float hz)
+        {
+            switch (scale)
+            {
+            case BandScale::MEL: return 2595.0f * std::log10(1.0f + hz / 700.0f);
+            case BandScale::LOG: return std::log(hz);
+            default: return hz;
+            }
+        }
+
+        static float fromScale(const BandScale scale, const float value)
+        {
+            switch (scale)
+            {
+            case BandScale::MEL: return 700.0f * (std::pow(10.0f, value / 2595.0f) - 1.0f);
+            case BandScale::LOG: return std::exp(value);
+            default: return value;
+            }
+        }
+
+    public:
+        // Band centers spread evenly on the given scale from min_hz to max_hz, bins span 0 to sample_rate / 2
+        Filterbank(const BandScale scale, const float sample_rate_hz, const float min_hz, const float max_hz)
+        {
+            static_assert(BINS < 65536 && MAX_WEIGHTS < 65536, "Band tables store 16-bit indices");
+
+            size_t used = 0;
+
+            if (scale == BandScale::LINEAR)
+            {
+                for (size_t b = 0; b < BANDS; b++)
+                {
+                    bands_[b] = {static_cast<uint16_t>(std::min(b, BINS - 1)), 1, static_cast<uint16_t>(used)};
+                    weights_[used++] = 1.0f;
+                }
+                return;
+            }
+
+            const float bin_hz = sample_rate_hz / (2.0f * BINS);
+            const float lo = toScale(scale, std::max(min_hz, bin_hz));
+            const float hi = toScale(scale, std::min(max_hz, sample_rate_hz / 2.0f - bin_hz));
+            const float step = (hi - lo) / static_cast<float>(BANDS - 1);
+
+            for (size_t b = 0; b < BANDS; b++)
+            {
+                const float left = fromScale(scale, lo + step * (static_cast<float>(b) - 1.0f)) / bin_hz;
+                const float center = fromScale(scale, lo + step * static_cast<float>(b)) / bin_hz;
+                const float right = fromScale(scale, lo + step * (static_cast<float>(b) + 1.0f)) / bin_hz;
+
+                // Bins strictly inside the triangle, in units of bins
+                const size_t first = static_cast<size_t>(std::max(0.0f, std::floor(left))) + 1;
+                const size_t last = std::min(BINS - 1, static_cast<size_t>(std::ceil(right)) - 1);
+
+                Band& band = bands_[b];
+                band.offset = static_cast<uint16_t>(used);
+
+                bool any = false;
+                if (first <= last && used + (last - first + 1) <= MAX_WEIGHTS)
+                {
+                    band.first_bin = static_cast<uint16_t>(first);
+                    band.count = static_cast<uint16_t>(last - first + 1);
+                    for (size_t k = first; k <= last; k++)
+                    {
+                        const float kf = static_cast<float>(k);
+                        const float w = kf <= center ? (kf - left) / (center - left) : (right - kf) / (right - center);
+                        weights_[used + (k - first)] = std::max(0.0f, w);
+                        any |= w > 0.0f;
+                    }
+                }
+
+                if (!any)
+                {
+                    // No bin center inside the triangle, interpolate at the band center
+                    const size_t below = std::min(static_cast<size_t>(center), BINS - 2);
+                    const float frac = std::clamp(center - static_cast<float>(below), 0.0f, 1.0f);
+                    band.first_bin = static_cast<uint16_t>(below);
+                    band.count = 2;
+                    weights_[used] = 1.0f - frac;
+                    weights_[used + 1] = frac;
+                }
+
+                used += band.count;
+            }
+        }
+
+        void apply(const std::array<float, BINS>& bins, std::array<float, BANDS>& bands) const
+        {
+            for (size_t b = 0; b < BANDS; b++)
+            {
+                const Band& band = bands_[b];
+                const float* w = &weights_[band.offset];
+                const float* m = &bins[band.first_bin];
+
+                float sum = 0.0f;
+                for (size_t i = 0; i < band.count; i++)
+                {
+                    sum += w[i] * m[i];
+                }
+                bands[b] = sum;
+            }
+        }
+    };
+}
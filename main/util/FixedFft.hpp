@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+#include "Fft.hpp"
+
+namespace util
+{
+    // Q31 fixed point, value / 2^31 in [-1, 1)
+    namespace q31
+    {
+        struct Complex
+        {
+            int32_t re;
+            int32_t im;
+        };
+
+        constexpr int32_t ONE = INT32_MAX;
+
+        // Rounded product of two Q31 values
+        inline int32_t mul(const int32_t a, const int32_t b)
+        {
+            return static_cast<int32_t>((static_cast<int64_t>(a) * b + (1LL << 30)) >> 31);
+        }
+
+        inline int32_t from_double(const double value)
+        {
+            return static_cast<int32_t>(std::clamp(std::lround(value * 2147483648.0), -2147483647L, 2147483647L));
+        }
+
+        // |z| by the two-line alpha-max-plus-beta-min approximation, within 1.3% of the exact magnitude
+        inline uint32_t magnitude(const Complex z)
+        {
+            const uint32_t a = std::abs(static_cast<int64_t>(z.re));
+            const uint32_t b = std::abs(static_cast<int64_t>(z.im));
+            const uint32_t hi = std::max(a, b);
+            const uint32_t lo = std::min(a, b);
+            return std::max(hi + (lo >> 5) * 5, (hi >> 5) * 27 + (lo >> 7) * 71);
+        }
+    }
+
+    // Symmetric Hann window in Q31, the fixed-point twin of hann_window<N>()
+    template <size_t N>
+    const std::array<int32_t, N>& hann_window_q31()
+    {
+        static const std::array<int32_t, N> window = []
+        {
+            std::array<int32_t, N> w{};
+            for (size_t i = 0; i < N; i++)
+            {
+                w[i] = q31::from_double(0.5 * (1.0 - std::cos(2.0 * M_PI * static_cast<double>(i) / (N - 1))));
+            }
+            return w;
+        }();
+        return window;
+    }
+
+    /**
+     * @brief Q31 counterpart of Fft<N>
+     *
+     * Same radix-4 DIF structure and bit-reversal. Every stage divides its inputs by its radix, so the output is the
+     * DFT divided by N and no stage can overflow as long as input magnitudes stay below 2^30.
+     */
+    template <size_t N>
+    class FixedFft final
+    {
+        static_assert(N >= 4 && std::has_single_bit(N), "FFT size must be a power of two of at least 4");
+
+    public:
+        using Complex = q31::Complex;
+
+        FixedFft() = delete;
+
+        static void transform(const std::span<Complex, N> x)
+        {
+            size_t span = N;
+            for (; span >= 4; span /= 4)
+            {
+                radix4Stage(x, span);
+            }
+            if (span == 2)
+            {
+                for (size_t i = 0; i < N; i += 2)
+                {
+                    const Complex a{x[i].re >> 1, x[i].im >> 1};
+                    const Complex b{x[i + 1].re >> 1, x[i + 1].im >> 1};
+                    x[i] = {a.re + b.re, a.im + b.im};
+                    x[i + 1] = {a.re - b.re, a.im - b.im};
+                }
+            }
+
+            BitReversal<N>::permute(x);
+        }
+
+    private:
+        // W^k = exp(-2 pi i k / N) for k < 3N/4
+        static inline const std::array<Complex, 3 * N / 4> TWIDDLES = []
+        {
+            std::array<Complex, 3 * N / 4> w{};
+            for (size_t k = 0; k < w.size(); k++)
+            {
+                const double angle = -2.0 * M_PI * static_cast<double>(k) / N;
+                w[k] = {q31::from_double(std::cos(angle)), q31::from_double(std::sin(angle))};
+            }
+            return w;
+        }();
+
+        static Complex mul(const Complex a, const Complex w)
+        {
+            const int64_t re = static_cast<int64_t>(a.re) * w.re - static_cast<int64_t>(a.im) * w.im;
+            const int64_t im = static_cast<int64_t>(a.re) * w.im + static_cast<int64_t>(a.im) * w.re;
+            return {static_cast<int32_t>((re + (1LL << 30)) >> 31), static_cast<int32_t>((im + (1LL << 30)) >> 31)};
+        }
+
+        static void radix4Stage(const std::span<Complex, N> x, const size_t span)
+        {
+            const size_t quarter = span / 4;
+            const size_t stride = N / span;
+
+            for (size_t base = 0; base < N; base += span)
+            {
+                Complex* const p = x.data() + base;
+                for (size_t j = 0; j < quarter; j++)
+                {
+                    const Complex a0{p[j].re >> 2, p[j].im >> 2};
+                    const Complex a1{p[j + quarter].re >> 2, p[j + quarter].im >> 2};
+                    const Complex a2{p[j + 2 * quarter].re >> 2, p[j + 2 * quarter].im >> 2};
+                    const Complex a3{p[j + 3 * quarter].re >> 2, p[j + 3 * quarter].im >> 2};
+
+                    const Complex t0{a0.re + a2.re, a0.im + a2.im};
+                    const Complex t1{a0.re - a2.re, a0.im - a2.im};
+                    const Complex t2{a1.re + a3.re, a1.im + a3.im};
+                    const Complex t3{a1.im - a3.im, a3.re - a1.re}; // -i * (a1 - a3)
+
+                    p[j] = {t0.re + t2.re, t0.im + t2.im};
+                    const Complex y1{t0.re - t2.re, t0.im - t2.im};
+                    const Complex y2{t1.re + t3.re, t1.im + t3.im};
+                    const Complex y3{t1.re - t3.re, t1.im - t3.im};
+                    if (j == 0)
+                    {
+                        p[j + quarter] = y1;
+                        p[j + 2 * quarter] = y2;
+                        p[j + 3 * quarter] = y3;
+                    }
+                    else
+                    {
+                        p[j + quarter] = mul(y1, TWIDDLES[2 * j * stride]);
+                        p[j + 2 * quarter] = mul(y2, TWIDDLES[j * stride]);
+                        p[j + 3 * quarter] = mul(y3, TWIDDLES[3 * j * stride]);
+                    }
+                }
+            }
+        }
+
+        template <size_t>
+        friend class FixedRealFft;
+    };
+
+    /**
+     * @brief Q31 counterpart of RealFft<N>
+     *
+     * Takes the N samples as Q31 pairs, each at most 2^29 in magnitude, and leaves bin k scaled by 2^-SCALE_SHIFT.
+     */
+    template <size_t N>
+    class FixedRealFft final
+    {
+        static_assert(N >= 8, "Real FFT size must be at least 8");
+
+    public:
+        using Complex = q31::Complex;
+
+        // Output bin = DFT bin / 2^SCALE_SHIFT: 1/(N/2) from the half-size FFT and 1/2 from the split
+        static constexpr int SCALE_SHIFT = std::countr_zero(N);
+
+        FixedRealFft() = delete;
+
+        // Same layout as RealFft<N>::transform, bin 0 and the Nyquist bin share x[0]
+        static void transform(const std::span<Complex, N / 2> x)
+        {
+            FixedFft<N / 2>::transform(x);
+
+            const Complex z0 = x[0];
+            x[0] = {(z0.re >> 1) + (z0.im >> 1), (z0.re >> 1) - (z0.im >> 1)};
+
+            for (size_t k = 1; k <= N / 4; k++)
+            {
+                const size_t m = N / 2 - k;
+                const int32_t ar = x[k].re >> 2, ai = x[k].im >> 2;
+                const int32_t br = x[m].re >> 2, bi = -(x[m].im >> 2);
+
+                // Halved even and odd parts, the extra 1/2 keeps even + W^k odd inside Q31
+                const Complex even{ar + br, ai + bi};
+                const Complex odd{ai - bi, br - ar};
+                const Complex t = FixedFft<N / 2>::mul(odd, TWIDDLES[k]);
+
+                x[k] = {even.re + t.re, even.im + t.im};
+                x[m] = {even.re - t.re, t.im - even.im};
+            }
+        }
+
+        // Approximate magnitude of bin k < N/2 after transform(), same scale as the bins
+        static uint32_t magnitude(const std::span<const Complex, N / 2> x, const size_t k)
+        {
+            if (k == 0) return std::abs(static_cast<int64_t>(x[0].re));
+            return q31::magnitude(x[k]);
+        }
+
+    private:
+        // W^k = exp(-2 pi i k / N) for k <= N/4
+        static inline const std::array<Complex, N / 4 + 1> TWIDDLES = []
+        {
+            std::array<Complex, N / 4 + 1> w{};
+            for (size_t k = 0; k < w.size(); k++)
+            {
+                const double angle = -2.0 * M_PI * static_cast<double>(k) / N;
+                w[k] = {q31::from_double(std::cos(angle)), q31::from_double(std::sin(angle))};
+            }
+            return w;
+        }();
+    };
+}
@@ -10,7 +10,7 @@ namespace util::http
     inline std::expected<std::string, esp_err_t> get_req_body(httpd_req_t* req, const std::string& tag)
     {
         const auto free_mem = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
-        ESP_LOGI(tag.c_str(), "Received content with length=%d, heap available=%d", req->content_len, free_mem);
+        ESP_LOGI(tag.c_str(), "Received content with length=%zu, heap available=%zu", req->content_len, free_mem);
 
         if (req->content_len == 0)
         {
@@ -27,7 +27,7 @@ namespace util::http
         std::string buffer;
         buffer.resize(req->content_len);
 
-        int total_received = 0;
+        size_t total_received = 0;
         while (total_received < req->content_len)
         {
             const auto received = httpd_req_recv(req, &buffer[total_received], req->content_len - total_received);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <span>
+
+namespace util
+{
+    /**
+     * @brief The most recent N samples of a stream
+     *
+     * Overlapping analysis windows push each hop of new samples and read the whole window back in order, the samples
+     * the windows share are never moved.
+     */
+    template <typename T, size_t N>
+    class SampleRing final
+    {
+        std::array<T, N> data_{};
+        size_t head_ = 0; // Oldest sample, also the next one overwritten
+
+    public:
+        void push(std::span<const T> samples)
+        {
+            if (samples.size() > N) samples = samples.last(N);
+
+            const size_t first = std::min(samples.size(), N - head_);
+            std::copy_n(samples.begin(), first, data_.begin() + head_);
+            std::copy(samples.begin() + first, samples.end(), data_.begin());
+            head_ = (head_ + samples.size()) % N;
+        }
+
+        // Oldest to newest
+        void copy_to(std::array<T, N>& out) const
+        {
+            const auto split = out.begin() + (N - head_);
+            std::copy(data_.begin() + head_, data_.end(), out.begin());
+            std::copy_n(data_.begin(), head_, split);
+        }
+
+        void clear()
+        {
+            data_.fill(T{});
+            head_ = 0;
+        }
+    };
+}
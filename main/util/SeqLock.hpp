@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace util
+{
+    /**
+     * @brief Single producer, multi consumer publication of the latest value with its sequence number
+     *
+     * Two seqlock-guarded slots: the producer writes the slot readers are not being directed to and then points them
+     * at it, so publishing never waits. Readers copy the latest slot and only retry if the producer got all the way
+     * around to that slot again during the copy, which takes two publishes. The value is stored as relaxed atomic
+     * words, torn copies are detected rather than being data races.
+     */
+    template <typename T>
+    class SeqLock final
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SeqLock copies values word by word");
+
+        static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+#if defined(__SANITIZE_THREAD__)
+        // ThreadSanitizer does not model fences, order every word instead so it checks the same guarantees
+        static constexpr bool FENCES = false;
+#else
+        static constexpr bool FENCES = true;
+#endif
+        static constexpr auto WORD_STORE = FENCES ? std::memory_order_relaxed : std::memory_order_release;
+        static constexpr auto WORD_LOAD = FENCES ? std::memory_order_relaxed : std::memory_order_acquire;
+
+        struct Slot
+        {
+            std::atomic<uint32_t> seq{0}; // 2n once publish n is complete, odd while being written
+            std::array<std::atomic<uint32_t>, WORDS> words{};
+        };
+
+        std::array<Slot, 2> slots_{};
+        std::atomic<uint32_t> published_{0};
+
+    public:
+        // Producer side, a single thread only
+        void publish(const T& value)
+        {
+            std::array<uint32_t, WORDS> words{};
+            std::memcpy(words.data(), &value, sizeof(T));
+
+            const uint32_t n = published_.load(std::memory_order_relaxed) + 1;
+            Slot& slot = slots_[n & 1];
+
+            slot.seq.store(2 * n - 1, std::memory_order_relaxed);
+            if constexpr (FENCES) std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; i++)
+            {
+                slot.words[i].store(words[i], WORD_STORE);
+            }
+            slot.seq.store(2 * n, std::memory_order_release);
+
+            published_.store(n, std::memory_order_release);
+        }
+
+        // Copies the latest value into out and returns its sequence number, the count of publishes so far. Before
+        // the first publish out is zeroed and 0 is returned.
+        uint32_t read(T& out) const
+        {
+            std::array<uint32_t, WORDS> words{};
+
+            while (true)
+            {
+                const uint32_t n = published_.load(std::memory_order_acquire);
+                const Slot& slot = slots_[n & 1];
+
+                const uint32_t before = slot.seq.load(std::memory_order_acquire);
+                if (before != 2 * n) continue; // Already being rewritten, a newer value is on the way
+
+                for (size_t i = 0; i < WORDS; i++)
+                {
+                    words[i] = slot.words[i].load(WORD_LOAD);
+                }
+                if constexpr (FENCES) std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (slot.seq.load(std::memory_order_relaxed) == before)
+                {
+                    std::memcpy(&out, words.data(), sizeof(T));
+                    return n;
+                }
+            }
+        }
+
+        // Sequence number of the latest value
+        [[nodiscard]] uint32_t sequence() const
+        {
+            return published_.load(std::memory_order_acquire);
+        }
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstdint>
+
+#include "Fft.hpp"
+#include "FixedFft.hpp"
+
+namespace util
+{
+    // Magnitude spectra of N microphone samples (24-bit, left-justified in int32_t) through a Hann window. All three
+    // produce the same bins on the same scale, a sample of 2^31 counting as 1.0, and own their working buffer.
+
+    // Real FFT in single-precision float
+    template <size_t N>
+    class FloatSpectrum final
+    {
+        std::array<std::complex<float>, N / 2> buffer_{};
+
+    public:
+        template <size_t BINS>
+        void compute(const std::array<int32_t, N>& samples, std::array<float, BINS>& spectrum)
+        {
+            static_assert(BINS <= N / 2, "Spectrum bins must be below Nyquist");
+            const auto& window = hann_window<N>();
+
+            // Real samples, so even/odd pairs go into one half-size complex FFT
+            for (size_t i = 0; i < N / 2; ++i)
+            {
+                const float even = static_cast<float>(samples[2 * i] >> 16) / 32768.0f;
+                const float odd = static_cast<float>(samples[2 * i + 1] >> 16) / 32768.0f;
+                buffer_[i] = {even * window[2 * i], odd * window[2 * i + 1]};
+            }
+
+            RealFft<N>::transform(buffer_);
+
+            for (size_t i = 0; i < BINS; ++i)
+            {
+                spectrum[i] = RealFft<N>::magnitude(buffer_, i);
+            }
+        }
+    };
+
+    // Real FFT in Q31, approximate magnitudes converted to float only at the end
+    template <size_t N>
+    class FixedSpectrum final
+    {
+        using Fft = FixedRealFft<N>;
+
+        std::array<q31::Complex, N / 2> buffer_{};
+
+    public:
+        template <size_t BINS>
+        void compute(const std::array<int32_t, N>& samples, std::array<float, BINS>& spectrum)
+        {
+            static_assert(BINS <= N / 2, "Spectrum bins must be below Nyquist");
+            const auto& window = hann_window_q31<N>();
+
+            // Left-justified samples are already Q31, the FFT wants them below 2^29
+            for (size_t i = 0; i < N / 2; ++i)
+            {
+                buffer_[i] = {q31::mul(samples[2 * i], window[2 * i]) >> 2,
+                              q31::mul(samples[2 * i + 1], window[2 * i + 1]) >> 2};
+            }
+
+            Fft::transform(buffer_);
+
+            // Undo the input and FFT scaling
+            constexpr float SCALE = static_cast<float>(1u << (Fft::SCALE_SHIFT + 2)) / 2147483648.0f;
+            for (size_t i = 0; i < BINS; ++i)
+            {
+                spectrum[i] = static_cast<float>(Fft::magnitude(buffer_, i)) * SCALE;
+            }
+        }
+    };
+
+    // Goertzel recurrences for the requested bins only
+    template <size_t N>
+    class GoertzelSpectrum final
+    {
+        std::array<float, N> buffer_{};
+
+    public:
+        template <size_t BINS>
+        void compute(const std::array<int32_t, N>& samples, std::array<float, BINS>& spectrum)
+        {
+            const auto& window = hann_window<N>();
+            for (size_t i = 0; i < N; ++i)
+            {
+                buffer_[i] = static_cast<float>(samples[i] >> 16) / 32768.0f * window[i];
+            }
+
+            Goertzel<N, BINS>::magnitudes(buffer_, spectrum);
+        }
+    };
+}
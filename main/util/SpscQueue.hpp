@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace util
+{
+    /**
+     * @brief Bounded single producer, single consumer FIFO
+     *
+     * Slots are filled and drained in place, so a producer in an interrupt handler copies its data exactly once and
+     * never allocates or waits. Each side only stores its own index, a full queue makes the producer drop rather
+     * than overwrite what the consumer may be reading. The producer side is always inlined, so a caller placed in
+     * IRAM runs none of it from flash.
+     */
+    template <typename T, size_t N>
+    class SpscQueue final
+    {
+        static_assert(std::has_single_bit(N), "Queue depth must be a power of two");
+
+        std::array<T, N> slots_{};
+        std::atomic<uint32_t> head_{0}; // Next slot to read, written by the consumer
+        std::atomic<uint32_t> tail_{0}; // Next slot to write, written by the producer
+
+    public:
+        // Producer side, the slot to fill before push() or nullptr if the queue is full
+        [[gnu::always_inline]] T* write_slot()
+        {
+            const uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == N) return nullptr;
+            return &slots_[tail & (N - 1)];
+        }
+
+        [[gnu::always_inline]] void push()
+        {
+            tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Consumer side, the oldest filled slot or nullptr if the queue is empty. Valid until pop().
+        const T* read_slot() const
+        {
+            const uint32_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+            return &slots_[head & (N - 1)];
+        }
+
+        void pop()
+        {
+            head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Filled slots, exact on either side and a snapshot anywhere else
+        [[nodiscard]] size_t size() const
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        // Drop every filled slot, only while neither side is running
+        void reset()
+        {
+            head_.store(0, std::memory_order_relaxed);
+            tail_.store(0, std::memory_order_relaxed);
+        }
+    };
+}
@@ -7,6 +7,7 @@
 
 #include "esp_pthread.h"
 #include "esp_log.h"
+#include "Metrics.hpp"
 
 class ThreadManager
 {
@@ -41,7 +42,16 @@ public:
         cfg.stack_size = stack_size_;
         cfg.prio = priority_;
         esp_pthread_set_cfg(&cfg);
-        thread_ = std::thread([this, func = std::move(thread_func)] { func(running_); });
+        thread_ = std::thread([this, func = std::move(thread_func)]
+        {
+#if CONFIG_TOTEM_METRICS
+            Metrics::registerTask(name_.c_str());
+#endif
+            func(running_);
+#if CONFIG_TOTEM_METRICS
+            Metrics::unregisterTask();
+#endif
+        });
     }
 
     void stop()
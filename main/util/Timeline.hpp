@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace util
+{
+    /**
+     * @brief Which cues cover the current time, for timelines with many cues
+     *
+     * Cues are half-open [begin, end) spans in milliseconds, several per id if needed, an id's spans that overlap or
+     * touch are merged. compile() turns them into one list of enter and leave events sorted by time, and the active set
+     * follows a cursor into that list: moving forward replays only the events passed, so a frame costs as much as
+     * the cues that start or stop in it. Every CHECKPOINT events the active set is saved, a seek binary searches the
+     * events and replays at most CHECKPOINT of them from the nearest saved set.
+     */
+    class Timeline final
+    {
+        static constexpr size_t CHECKPOINT = 32;
+
+        struct Span
+        {
+            uint32_t id;
+            uint32_t begin_ms;
+            uint32_t end_ms;
+        };
+
+        struct Event
+        {
+            uint32_t time_ms;
+            uint32_t id;
+            bool enter; // Leaves sort first, a cue ending where another starts is never active twice
+        };
+
+        std::vector<Span> spans_;
+        std::vector<Event> events_;
+        // Active ids before events_[i * CHECKPOINT], flattened with their offsets into checkpoint_ids_
+        std::vector<uint32_t> checkpoint_ids_;
+        std::vector<uint32_t> checkpoint_offsets_;
+
+        std::vector<uint32_t> active_; // Sorted by id
+        size_t cursor_ = 0; // Next event to apply
+        uint32_t time_ms_ = 0;
+
+        void apply(const Event& event)
+        {
+            const auto it = std::ranges::lower_bound(active_, event.id);
+            if (event.enter) active_.insert(it, event.id);
+            else if (it != active_.end() && *it == event.id) active_.erase(it);
+        }
+
+    public:
+        void clear()
+        {
+            spans_.clear();
+            events_.clear();
+            checkpoint_ids_.clear();
+            checkpoint_offsets_.clear();
+            active_.clear();
+            cursor_ = 0;
+            time_ms_ = 0;
+        }
+
+        // Spans may be added in any order, they take effect at the next compile()
+        void add(const uint32_t id, const uint32_t begin_ms, const uint32_t end_ms)
+        {
+            if (begin_ms >= end_ms) return;
+            spans_.push_back({id, begin_ms, end_ms});
+        }
+
+        void compile()
+        {
+            std::ranges::sort(spans_, [](const Span& a, const Span& b)
+            {
+                return a.id != b.id ? a.id < b.id : a.begin_ms < b.begin_ms;
+            });
+
+            events_.clear();
+            for (size_t i = 0; i < spans_.size();)
+            {
+                const Span& first = spans_[i];
+                uint32_t end_ms = first.end_ms;
+                for (i++; i < spans_.size() && spans_[i].id == first.id && spans_[i].begin_ms <= end_ms; i++)
+                {
+                    end_ms = std::max(end_ms, spans_[i].end_ms);
+                }
+                events_.push_back({first.begin_ms, first.id, true});
+                events_.push_back({end_ms, first.id, false});
+            }
+
+            std::ranges::sort(events_, [](const Event& a, const Event& b)
+            {
+                return a.time_ms != b.time_ms ? a.time_ms < b.time_ms : a.enter < b.enter;
+            });
+
+            // Sized for every cue being active at once, so that moving the cursor never allocates
+            active_.clear();
+            active_.reserve(events_.size() / 2);
+            checkpoint_ids_.clear();
+            checkpoint_offsets_.clear();
+            for (size_t i = 0; i <= events_.size(); i++)
+            {
+                if (i % CHECKPOINT == 0)
+                {
+                    checkpoint_offsets_.push_back(checkpoint_ids_.size());
+                    checkpoint_ids_.insert(checkpoint_ids_.end(), active_.begin(), active_.end());
+                }
+                if (i < events_.size()) apply(events_[i]);
+            }
+            checkpoint_offsets_.push_back(checkpoint_ids_.size());
+
+            seek(0);
+        }
+
+        // Jump to any time, O(log n) to find the events plus at most CHECKPOINT replayed
+        void seek(const uint32_t time_ms)
+        {
+            time_ms_ = time_ms;
+            if (checkpoint_offsets_.empty()) return; // Not compiled yet
+
+            const auto end = std::ranges::upper_bound(events_, time_ms, {}, &Event::time_ms) - events_.begin();
+            const size_t checkpoint = end / CHECKPOINT;
+
+            active_.assign(checkpoint_ids_.begin() + checkpoint_offsets_[checkpoint],
+                           checkpoint_ids_.begin() + checkpoint_offsets_[checkpoint + 1]);
+            for (cursor_ = checkpoint * CHECKPOINT; cursor_ < static_cast<size_t>(end); cursor_++)
+            {
+                apply(events_[cursor_]);
+            }
+        }
+
+        // Move to time_ms, forward by replaying the events passed, backward (e.g. a looping timeline) by a seek
+        void advance(const uint32_t time_ms)
+        {
+            if (time_ms < time_ms_)
+            {
+                seek(time_ms);
+                return;
+            }
+
+            for (; cursor_ < events_.size() && events_[cursor_].time_ms <= time_ms; cursor_++)
+            {
+                apply(events_[cursor_]);
+            }
+            time_ms_ = time_ms;
+        }
+
+        // Ids of the cues covering the current time, in ascending order
+        [[nodiscard]] std::span<const uint32_t> active() const
+        {
+            return active_;
+        }
+    };
+}
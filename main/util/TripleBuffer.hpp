@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace util
+{
+    /**
+     * @brief Single producer, single consumer handoff of the latest value
+     *
+     * The producer always owns a slot to write into and the consumer always owns a stable slot to read from, the
+     * third slot holds the most recently published value. Neither side ever waits for the other, a value that is
+     * published twice before the consumer looks is simply replaced.
+     */
+    template <typename T>
+    class TripleBuffer
+    {
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t FRESH_BIT = 0x4;
+
+        std::array<T, 3> slots_{};
+        uint8_t write_idx_ = 0;
+        std::atomic<uint8_t> ready_idx_{1};
+        uint8_t read_idx_ = 2;
+
+    public:
+        // Producer side, valid until the next publish()
+        T& write_slot()
+        {
+            return slots_[write_idx_];
+        }
+
+        void publish()
+        {
+            const uint8_t prev = ready_idx_.exchange(write_idx_ | FRESH_BIT, std::memory_order_acq_rel);
+            write_idx_ = prev & INDEX_MASK;
+        }
+
+        // Consumer side, swaps in the latest published slot. Returns false if nothing was published since the
+        // last call, read_slot() then keeps the previous value.
+        bool consume()
+        {
+            if ((ready_idx_.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+            {
+                return false;
+            }
+
+            const uint8_t prev = ready_idx_.exchange(read_idx_, std::memory_order_acq_rel);
+            read_idx_ = prev & INDEX_MASK;
+            return true;
+        }
+
+        [[nodiscard]] const T& read_slot() const
+        {
+            return slots_[read_idx_];
+        }
+    };
+}